@@ -0,0 +1,389 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "amazons.hpp"
+#include "AlphaBeta.hpp"
+#include "Board.hpp"
+#include "Endgame.hpp"
+#include "EvalState.hpp"
+#include "Evaluator.hpp"
+#include "SearchController.hpp"
+
+namespace BOARD_NAMESPACE {
+
+// a score for the player to move, from an evaluation which is positive when left is better
+#define score_for(p, eval) (p ? (eval) : -(eval))
+
+AlphaBeta::AlphaBeta() {
+    this->move_lists = new MoveList[AB_MAX_PLY];
+    this->move_scores = new int[AB_MAX_PLY][MAX_MOVES];
+    this->move_history = new int[2][SETSIZE][SETSIZE]();
+    this->arrow_history = new int[2][SETSIZE]();
+    memset(this->killers, 0, sizeof(this->killers));
+
+    this->controller = NULL;
+    this->max_depth = 0;
+    this->nodes = 0;
+    this->aborted = false;
+    this->iteration_best = NO_MOVE;
+    this->depth_reached = 0;
+    this->best_score = 0;
+}
+
+AlphaBeta::~AlphaBeta() {
+    delete[] this->move_lists;
+    delete[] this->move_scores;
+    delete[] this->move_history;
+    delete[] this->arrow_history;
+}
+
+/*
+ * Scores the moves of move_lists[ply] for ordering: the killers first,
+ * then by the evaluation of the resulting position when asked for it,
+ * and by the history heuristic otherwise
+ *
+ * Params:
+ *     board - the position
+ *     state - the move counts of board
+ *     player - the player to move
+ *     ply - how far the position is below the root
+ *     by_eval - whether to score by evaluation
+ *     evaluator - the heuristic to evaluate with
+ * Return: none
+ */
+template<class E>
+void AlphaBeta::order_moves(Board& board, const EvalState& state, player_t player, int ply, bool by_eval,
+                            const E& evaluator) {
+    const MoveList& moves = this->move_lists[ply];
+    int *scores = this->move_scores[ply];
+
+    // the killers are evaluated along with the rest, so that the children go in one batch
+    if(by_eval)
+        evaluator.evaluate_children(board, state, player, moves.begin(), moves.size(), scores);
+    for(int i=0; i < moves.size(); i++) {
+        packed_move_t move = moves[i];
+
+        if(move == this->killers[ply][0]) {
+            scores[i] = AB_KILLER_BONUS + 1;
+        } else if(move == this->killers[ply][1]) {
+            scores[i] = AB_KILLER_BONUS;
+        } else if(by_eval) {
+            scores[i] = score_for(player, scores[i]);
+        } else {
+            scores[i] = this->move_history[player][move_old_loc(move)][move_new_loc(move)]
+                        + this->arrow_history[player][move_arrow(move)];
+        }
+    }
+}
+
+/*
+ * Swaps the best scoring of the moves from index onwards into index, so
+ * that moves are only sorted as far as the search gets before a cutoff
+ *
+ * Params:
+ *     ply - the ply whose moves to pick from
+ *     index - the position to fill
+ * Return: the move now at index
+ */
+packed_move_t AlphaBeta::pick_move(int ply, int index) {
+    MoveList& moves = this->move_lists[ply];
+    int *scores = this->move_scores[ply];
+    int best = index;
+
+    for(int i=index + 1; i < moves.size(); i++) {
+        if(scores[i] > scores[best])
+            best = i;
+    }
+    if(best != index) {
+        moves.swap(index, best);
+        int score = scores[index];
+        scores[index] = scores[best];
+        scores[best] = score;
+    }
+    return moves[index];
+}
+
+// credits a move that caused a cutoff, so that it is tried early elsewhere
+void AlphaBeta::record_cutoff(player_t player, int ply, int depth, packed_move_t move) {
+    if(move != this->killers[ply][0]) {
+        this->killers[ply][1] = this->killers[ply][0];
+        this->killers[ply][0] = move;
+    }
+    this->move_history[player][move_old_loc(move)][move_new_loc(move)] += depth * depth;
+    this->arrow_history[player][move_arrow(move)] += depth * depth;
+}
+
+/*
+ * Principal variation search below the root, in negamax form
+ *
+ * Params:
+ *     board - the position
+ *     state - the move counts of board
+ *     player - the player to move
+ *     depth - the plies left to search
+ *     ply - how far the position is below the root
+ *     alpha - the score player is already sure of
+ *     beta - the score the opponent is already sure of
+ *     evaluator - the heuristic to evaluate leaves with
+ * Return: an int - the score of the position for player, exact if it
+ *         is strictly between alpha and beta, and a bound otherwise
+ */
+template<class E>
+int AlphaBeta::search_node(Board& board, const EvalState& state, player_t player, int depth, int ply,
+                           int alpha, int beta, const E& evaluator) {
+    if(++this->nodes % AB_CHECK_INTERVAL == 0 && this->controller->time_is_up())
+        this->aborted = true;
+    if(this->aborted)
+        return 0;
+
+    if(state.get_num_moves(player) == 0)
+        return -(BIGNUM - ply); // player has lost. The later, the better
+    if(depth == 0 || ply == AB_MAX_PLY - 1)
+        return score_for(player, evaluator.evaluate(board, state));
+
+    MoveList& moves = this->move_lists[ply];
+    board.get_moves(player, moves);
+    this->order_moves(board, state, player, ply, depth >= AB_EVAL_ORDER_DEPTH, evaluator);
+
+    int best_score = -AB_INFINITY;
+    for(int i=0; i < moves.size(); i++) {
+        packed_move_t move = this->pick_move(ply, i);
+        EvalState child_state = state;
+        board.do_move(player, move);
+        child_state.update(board, player, move);
+
+        int score;
+        if(i == 0) {
+            score = -this->search_node(board, child_state, !player, depth - 1, ply + 1, -beta, -alpha, evaluator);
+        } else {
+            // every later move is expected to be worse, which a null window proves cheaply
+            score = -this->search_node(board, child_state, !player, depth - 1, ply + 1, -alpha - 1, -alpha,
+                                       evaluator);
+            if(score > alpha && score < beta)
+                score = -this->search_node(board, child_state, !player, depth - 1, ply + 1, -beta, -alpha,
+                                           evaluator);
+        }
+        board.undo_move(player, move);
+        if(this->aborted)
+            return 0;
+
+        if(score > best_score) {
+            best_score = score;
+            if(score > alpha)
+                alpha = score;
+            if(alpha >= beta) {
+                this->record_cutoff(player, ply, depth, move);
+                break;
+            }
+        }
+    }
+    return best_score;
+}
+
+/*
+ * Searches every move of the root to the passed depth, best moves of
+ * the previous iteration first. Leaves the best move first in the list
+ *
+ * Params:
+ *     board - the position
+ *     state - the move counts of board
+ *     player - the player to move
+ *     depth - the plies to search
+ *     alpha - the low end of the aspiration window
+ *     beta - the high end of the aspiration window
+ *     evaluator - the heuristic to evaluate leaves with
+ * Return: an int - the score of the best move for player, or a bound
+ *         if it falls outside the window
+ */
+template<class E>
+int AlphaBeta::search_root(Board& board, const EvalState& state, player_t player, int depth,
+                           int alpha, int beta, const E& evaluator) {
+    MoveList& moves = this->move_lists[0];
+    int best_score = -AB_INFINITY;
+    int best_index = -1;
+
+    this->iteration_best = NO_MOVE;
+    for(int i=0; i < moves.size(); i++) {
+        packed_move_t move = moves[i];
+        EvalState child_state = state;
+        board.do_move(player, move);
+        child_state.update(board, player, move);
+
+        int score;
+        if(i == 0) {
+            score = -this->search_node(board, child_state, !player, depth - 1, 1, -beta, -alpha, evaluator);
+        } else {
+            score = -this->search_node(board, child_state, !player, depth - 1, 1, -alpha - 1, -alpha, evaluator);
+            if(score > alpha && score < beta)
+                score = -this->search_node(board, child_state, !player, depth - 1, 1, -beta, -alpha, evaluator);
+        }
+        board.undo_move(player, move);
+        if(this->aborted)
+            break;
+
+        if(score > best_score) {
+            best_score = score;
+            if(score > alpha) {
+                alpha = score;
+                best_index = i;
+                this->iteration_best = move;
+            }
+            if(alpha >= beta)
+                break;
+        }
+    }
+
+    // the best move goes first, and the rest keep the order they were searched in
+    for(int i=best_index; i > 0; i--)
+        moves.swap(i, i - 1);
+    return best_score;
+}
+
+/*
+ * Reports the last finished iteration to the controller's monitor
+ *
+ * Params:
+ *     controller - the controller of the running search
+ *     best_move - the best move the iteration found
+ * Return: none
+ */
+void AlphaBeta::report_progress(const SearchController& controller, packed_move_t best_move) const {
+    search_info_t info = {};
+    info.nodes = this->nodes;
+    info.depth = this->depth_reached;
+    info.score = this->best_score;
+    info.best_move = best_move;
+    controller.report(info);
+}
+
+/*
+ * Deepens the search one ply at a time until a limit runs out
+ *
+ * Params:
+ *     board - the position
+ *     player - the player to move
+ *     config - the settings to search with
+ *     evaluator - the heuristic to evaluate leaves with
+ * Return: the best move found
+ */
+template<class E>
+packed_move_t AlphaBeta::search(Board& board, player_t player, const ai_config_t& config, const E& evaluator) {
+    SearchController controller(config.limits, board.num_empty_squares(), config.monitor);
+    EvalState state(board);
+    MoveList& moves = this->move_lists[0];
+
+    this->controller = &controller;
+    this->nodes = 0;
+    this->aborted = false;
+    this->depth_reached = 0;
+    if(config.limits.max_depth > 0)
+        this->max_depth = std::min(config.limits.max_depth, AB_MAX_PLY - 1);
+    else
+        this->max_depth = (controller.get_time_budget() > 0) ? AB_MAX_PLY - 1 : AB_DEFAULT_DEPTH;
+
+    // what was learned about moves in the last search fades, and killers are
+    // forgotten since their plies now mean different positions
+    for(int p=0; p < 2; p++) {
+        for(int i=0; i < SETSIZE; i++) {
+            for(int j=0; j < SETSIZE; j++)
+                this->move_history[p][i][j] /= 2;
+            this->arrow_history[p][i] /= 2;
+        }
+    }
+    memset(this->killers, 0, sizeof(this->killers));
+
+    // the root moves are sorted once by evaluation, then kept in the order of the last iteration
+    board.get_moves(player, moves);
+    this->order_moves(board, state, player, 0, true, evaluator);
+    for(int i=0; i < moves.size(); i++)
+        this->pick_move(0, i);
+
+    packed_move_t best_move = moves[0];
+    this->best_score = score_for(player, evaluator.evaluate(board, state));
+    if(moves.size() == 1)
+        return best_move;
+
+    for(int depth=1; depth <= this->max_depth; depth++) {
+        int alpha = -AB_INFINITY;
+        int beta = AB_INFINITY;
+        int score;
+
+        if(depth >= AB_ASPIRATION_DEPTH) {
+            alpha = this->best_score - AB_ASPIRATION_WINDOW;
+            beta = this->best_score + AB_ASPIRATION_WINDOW;
+        }
+        while(true) {
+            score = this->search_root(board, state, player, depth, alpha, beta, evaluator);
+            if(this->aborted)
+                break;
+            if(score <= alpha) // failed low: the score is only an upper bound
+                alpha = -AB_INFINITY;
+            else if(score >= beta) // failed high: the score is only a lower bound
+                beta = AB_INFINITY;
+            else
+                break;
+        }
+
+        // even an unfinished iteration's best move beat every move searched before it
+        if(this->iteration_best != NO_MOVE)
+            best_move = this->iteration_best;
+        if(this->aborted)
+            break;
+        this->best_score = score;
+        this->depth_reached = depth;
+        this->report_progress(controller, best_move);
+
+        if(abs(score) >= AB_WIN) // the game is decided
+            break;
+        if(controller.get_time_budget() > 0
+           && controller.elapsed() >= controller.get_time_budget() * AB_NEXT_ITERATION)
+            break; // the next iteration wouldn't finish
+    }
+
+    this->controller = NULL;
+    return best_move;
+}
+
+/*
+ * The AI searches the position and makes its move on board. If the
+ * endgame solver can pick the move, there is no search
+ *
+ * Params:
+ *     board - the main game board on which the AI will move
+ *     player - the player to move
+ *     config - the settings to search with
+ * Returns: the move the AI made
+ */
+move_t AlphaBeta::make_move(Board& board, player_t player, const ai_config_t& config) {
+    endgame_result_t endgame = solve_endgame(board, player, ENDGAME_ROOT_NODES);
+    packed_move_t move = endgame.move;
+
+    if(move == NO_MOVE) {
+        switch(config.evaluator.type) {
+            case territory_evaluator:
+                move = this->search(board, player, config, TerritoryEvaluator(config.evaluator.territory));
+                break;
+            case classic_evaluator:
+            default:
+                move = this->search(board, player, config, ClassicEvaluator(config.evaluator.classic));
+                break;
+        }
+    } else {
+        this->nodes = 0;
+        this->depth_reached = 0;
+        this->best_score = score_for(player, verdict_eval(endgame.verdict));
+    }
+
+    bool legal = board.make_move(player, move);
+    assert(legal);
+    return unpack_move(move);
+}
+
+// prints the depth, score and node count of the last search to stdout
+void AlphaBeta::print_stats() const {
+    printf("alpha-beta: depth %d, score %d, %ld nodes\n", this->depth_reached, this->best_score, this->nodes);
+}
+
+} // namespace BOARD_NAMESPACE
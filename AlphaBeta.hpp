@@ -0,0 +1,171 @@
+#ifndef ALPHABETA_H
+#define ALPHABETA_H
+
+// A depth first alternative to the Monte Carlo tree search of MoveTree:
+// principal variation search, deepened one ply at a time until the time
+// runs out. Once arrows have cut the branching factor down, in the middle
+// and end of the game, it sees further ahead than MCTS in the same time.
+// Moves are ordered by the previous iteration's best move, killer moves,
+// the history heuristic and, where the subtree is deep enough to pay for
+// it, the evaluation of the position each move leads to. All the memory
+// the search needs is allocated with the searcher, so searching allocates
+// nothing, and moves are made and taken back on the one board searched
+// rather than copied into a new board for each position
+
+#include "amazons.hpp"
+#include "Board.hpp"
+#include "EvalState.hpp"
+#include "SearchController.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define AB_MAX_PLY 64 // the deepest the search goes
+#define AB_DEFAULT_DEPTH 2 // the depth searched when there is neither a time nor a depth limit
+#define AB_INFINITY (BIGNUM + 1) // beyond any score
+#define AB_WIN (BIGNUM - AB_MAX_PLY) // scores at least this good are forced wins
+#define AB_ASPIRATION_DEPTH 3 // the first iteration searched with an aspiration window
+#define AB_ASPIRATION_WINDOW 100 // how far either side of the last score the window reaches
+#define AB_EVAL_ORDER_DEPTH 2 // the least depth at which moves are ordered by evaluation
+#define AB_CHECK_INTERVAL 256 // nodes searched between checks of the clock
+#define AB_NEXT_ITERATION 0.4 // the fraction of the time budget after which no new iteration starts
+
+#define AB_KILLER_BONUS (1 << 29) // a move ordering score above any evaluation or history score
+
+class AlphaBeta {
+    MoveList *move_lists; // the moves at each ply
+    int (*move_scores)[MAX_MOVES]; // the ordering score of each move at each ply
+    packed_move_t killers[AB_MAX_PLY][2]; // the last two quiet moves to cause a cutoff at each ply
+    int (*move_history)[SETSIZE][SETSIZE]; // cutoff credit per player, amazon start and finish square
+    int (*arrow_history)[SETSIZE]; // cutoff credit per player and arrow square
+
+    SearchController *controller;
+    int max_depth;
+    long nodes; // positions searched so far in this search
+    bool aborted; // the clock ran out mid iteration, so its scores are unusable
+    // the best root move of the current iteration, once one has been searched
+    // fully and scored inside the window. Usable even if the iteration is aborted
+    packed_move_t iteration_best;
+
+    // the results of the last search
+    int depth_reached;
+    int best_score;
+
+    /*
+     * Scores the moves of move_lists[ply] for ordering: the killers first,
+     * then by the evaluation of the resulting position when asked for it,
+     * and by the history heuristic otherwise
+     *
+     * Params:
+     *     board - the position
+     *     state - the move counts of board
+     *     player - the player to move
+     *     ply - how far the position is below the root
+     *     by_eval - whether to score by evaluation
+     *     evaluator - the heuristic to evaluate with
+     * Return: none
+     */
+    template<class E>
+    void order_moves(Board& board, const EvalState& state, player_t player, int ply, bool by_eval,
+                     const E& evaluator);
+
+    /*
+     * Swaps the best scoring of the moves from index onwards into index, so
+     * that moves are only sorted as far as the search gets before a cutoff
+     *
+     * Params:
+     *     ply - the ply whose moves to pick from
+     *     index - the position to fill
+     * Return: the move now at index
+     */
+    packed_move_t pick_move(int ply, int index);
+
+    // credits a move that caused a cutoff, so that it is tried early elsewhere
+    void record_cutoff(player_t player, int ply, int depth, packed_move_t move);
+
+    /*
+     * Principal variation search below the root, in negamax form
+     *
+     * Params:
+     *     board - the position
+     *     state - the move counts of board
+     *     player - the player to move
+     *     depth - the plies left to search
+     *     ply - how far the position is below the root
+     *     alpha - the score player is already sure of
+     *     beta - the score the opponent is already sure of
+     *     evaluator - the heuristic to evaluate leaves with
+     * Return: an int - the score of the position for player, exact if it
+     *         is strictly between alpha and beta, and a bound otherwise
+     */
+    template<class E>
+    int search_node(Board& board, const EvalState& state, player_t player, int depth, int ply,
+                    int alpha, int beta, const E& evaluator);
+
+    /*
+     * Searches every move of the root to the passed depth, best moves of
+     * the previous iteration first. Leaves the best move first in the list
+     *
+     * Params:
+     *     board - the position
+     *     state - the move counts of board
+     *     player - the player to move
+     *     depth - the plies to search
+     *     alpha - the low end of the aspiration window
+     *     beta - the high end of the aspiration window
+     *     evaluator - the heuristic to evaluate leaves with
+     * Return: an int - the score of the best move for player, or a bound
+     *         if it falls outside the window
+     */
+    template<class E>
+    int search_root(Board& board, const EvalState& state, player_t player, int depth,
+                    int alpha, int beta, const E& evaluator);
+
+    /*
+     * Reports the last finished iteration to the controller's monitor
+     *
+     * Params:
+     *     controller - the controller of the running search
+     *     best_move - the best move the iteration found
+     * Return: none
+     */
+    void report_progress(const SearchController& controller, packed_move_t best_move) const;
+
+    /*
+     * Deepens the search one ply at a time until a limit runs out
+     *
+     * Params:
+     *     board - the position
+     *     player - the player to move
+     *     config - the settings to search with
+     *     evaluator - the heuristic to evaluate leaves with
+     * Return: the best move found
+     */
+    template<class E>
+    packed_move_t search(Board& board, player_t player, const ai_config_t& config, const E& evaluator);
+
+    public:
+    AlphaBeta();
+    ~AlphaBeta();
+
+    AlphaBeta(const AlphaBeta&) = delete;
+    AlphaBeta& operator=(const AlphaBeta&) = delete;
+
+    /*
+     * The AI searches the position and makes its move on board. If the
+     * endgame solver can pick the move, there is no search
+     *
+     * Params:
+     *     board - the main game board on which the AI will move
+     *     player - the player to move
+     *     config - the settings to search with
+     * Returns: the move the AI made
+     */
+    move_t make_move(Board& board, player_t player, const ai_config_t& config);
+
+    // prints the depth, score and node count of the last search to stdout
+    void print_stats() const;
+};
+
+} // namespace BOARD_NAMESPACE
+
+#endif
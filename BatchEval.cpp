@@ -0,0 +1,389 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+#include "BatchEval.hpp"
+
+namespace BOARD_NAMESPACE {
+
+// Lane code is always inlined into the kernel using it, so that it is
+// compiled for that kernel's instruction set
+#define LANE_INLINE inline __attribute__((always_inline))
+
+// the per byte counts summed over one direction of count_queen_moves() must
+// fit in a byte: up to 8 bits per byte of each word, for each step of a ray
+static_assert(8 * BBWORDS * (BOARDWIDTH - 1) < 256, "queen move counts would overflow their bytes");
+
+/*
+ * N bitboards side by side: word i of bitboard c is lane c of words[i].
+ * The operations are those of Bitboard, done on every lane at once
+ */
+template<int N>
+class Lanes {
+    public:
+    typedef uint64_t word_t __attribute__((vector_size(8 * N)));
+
+    word_t words[BBWORDS];
+
+    // lane c of w. With one lane, word_t is a plain uint64_t rather than a vector
+    static LANE_INLINE uint64_t& lane(word_t& w, int c) {return reinterpret_cast<uint64_t *>(&w)[c];}
+    static LANE_INLINE uint64_t lane(const word_t& w, int c) {return reinterpret_cast<const uint64_t *>(&w)[c];}
+
+    LANE_INLINE Lanes() {
+        for(int i=0; i < BBWORDS; i++)
+            words[i] = word_t{};
+    }
+
+    // boards[c] in lane c
+    static LANE_INLINE Lanes load(const Bitboard *boards) {
+        Lanes r;
+        for(int i=0; i < BBWORDS; i++)
+            for(int c=0; c < N; c++)
+                lane(r.words[i], c) = boards[c].word(i);
+        return r;
+    }
+
+    // the square squares[c] alone in lane c
+    static LANE_INLINE Lanes square(const int *squares) {
+        Lanes r;
+        for(int c=0; c < N; c++)
+            lane(r.words[squares[c] >> 6], c) = 1ULL << (squares[c] & 63);
+        return r;
+    }
+
+    LANE_INLINE Lanes& operator|=(const Lanes& other) {
+        for(int i=0; i < BBWORDS; i++)
+            words[i] |= other.words[i];
+        return *this;
+    }
+
+    LANE_INLINE Lanes& operator&=(const Lanes& other) {
+        for(int i=0; i < BBWORDS; i++)
+            words[i] &= other.words[i];
+        return *this;
+    }
+
+    LANE_INLINE Lanes operator|(const Lanes& other) const {Lanes r(*this); return r |= other;}
+    LANE_INLINE Lanes operator&(const Lanes& other) const {Lanes r(*this); return r &= other;}
+
+    // complement, restricted to the SETSIZE real bits
+    LANE_INLINE Lanes operator~() const {
+        Lanes r;
+        for(int i=0; i < BBWORDS; i++)
+            r.words[i] = ~words[i];
+        r.words[LAST_WORD] &= LAST_WORD_MASK;
+        for(int i=LAST_WORD + 1; i < BBWORDS; i++)
+            r.words[i] = word_t{};
+        return r;
+    }
+
+    // whether any lane has a bit set
+    LANE_INLINE bool any() const {
+        word_t acc = words[0];
+        for(int i=1; i < BBWORDS; i++)
+            acc |= words[i];
+        for(int c=0; c < N; c++)
+            if(lane(acc, c) != 0) return true;
+        return false;
+    }
+
+    // Counts are passed by reference rather than returned, since the ABI
+    // for returning vectors depends on the instruction set
+
+    // adds the bits set in each byte of each lane, summed over the words, to bytes
+    LANE_INLINE void add_byte_counts(word_t& bytes) const {
+        for(int i=0; i < BBWORDS; i++) {
+            word_t w = words[i];
+            w = w - ((w >> 1) & 0x5555555555555555ULL);
+            w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+            bytes += (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        }
+    }
+
+    // adds up the bytes of each lane of bytes, and adds the sums to total
+    static LANE_INLINE void add_bytes(const word_t& bytes, word_t& total) {
+        word_t w = (bytes & 0x00FF00FF00FF00FFULL) + ((bytes >> 8) & 0x00FF00FF00FF00FFULL);
+        w = (w & 0x0000FFFF0000FFFFULL) + ((w >> 16) & 0x0000FFFF0000FFFFULL);
+        total += (w & 0xFFFFFFFFULL) + (w >> 32);
+    }
+
+    // adds the number of bits set in each lane to total
+    LANE_INLINE void add_count(word_t& total) const {
+        word_t bytes = word_t{};
+        this->add_byte_counts(bytes);
+        add_bytes(bytes, total);
+    }
+
+    // Bitboard::shifted(), lane by lane
+    template<int S>
+    LANE_INLINE Lanes shifted() const {
+        Lanes r;
+        if(S >= 0) {
+            const int word_shift = S / 64;
+            const int bit_shift = S % 64;
+            for(int i=BBWORDS - 1; i >= word_shift; i--) {
+                word_t w = words[i - word_shift] << bit_shift;
+                if(bit_shift != 0 && i - word_shift - 1 >= 0)
+                    w |= words[i - word_shift - 1] >> ((64 - bit_shift) & 63);
+                r.words[i] = w;
+            }
+        } else {
+            const int word_shift = (-S) / 64;
+            const int bit_shift = (-S) % 64;
+            for(int i=0; i + word_shift < BBWORDS; i++) {
+                word_t w = words[i + word_shift] >> bit_shift;
+                if(bit_shift != 0 && i + word_shift + 1 < BBWORDS)
+                    w |= words[i + word_shift + 1] << ((64 - bit_shift) & 63);
+                r.words[i] = w;
+            }
+        }
+        return r;
+    }
+
+    // Bitboard::occluded_fill()
+    template<int S>
+    static LANE_INLINE Lanes occluded_fill(const Lanes& from, const Lanes& through) {
+        Lanes gen = from;
+        Lanes pro = through;
+        gen |= pro & gen.template shifted<S>();
+        pro &= pro.template shifted<S>();
+        gen |= pro & gen.template shifted<2 * S>();
+        pro &= pro.template shifted<2 * S>();
+        gen |= pro & gen.template shifted<4 * S>();
+        if(BOARDWIDTH - 1 > 7) {
+            pro &= pro.template shifted<4 * S>();
+            gen |= pro & gen.template shifted<8 * S>();
+        }
+        return gen;
+    }
+
+    template<int S>
+    static LANE_INLINE Lanes sliding_attacks(const Lanes& gen, const Lanes& empty) {
+        return occluded_fill<S>(gen, empty).template shifted<S>() & empty;
+    }
+
+    // Bitboard::queen_attacks()
+    static LANE_INLINE Lanes queen_attacks(const Lanes& gen, const Lanes& empty) {
+        return sliding_attacks<-BBWIDTH - 1>(gen, empty)
+             | sliding_attacks<-BBWIDTH>(gen, empty)
+             | sliding_attacks<-BBWIDTH + 1>(gen, empty)
+             | sliding_attacks<-1>(gen, empty)
+             | sliding_attacks<1>(gen, empty)
+             | sliding_attacks<BBWIDTH - 1>(gen, empty)
+             | sliding_attacks<BBWIDTH>(gen, empty)
+             | sliding_attacks<BBWIDTH + 1>(gen, empty);
+    }
+
+    // Bitboard::count_sliding_moves(), added to total. The steps' counts are
+    // kept per byte until the ray ends in every lane
+    template<int S>
+    static LANE_INLINE void add_sliding_moves(const Lanes& gen, const Lanes& empty, word_t& total) {
+        Lanes step = gen;
+        word_t bytes = word_t{};
+        do {
+            step = step.template shifted<S>() & empty;
+            step.add_byte_counts(bytes);
+        } while(step.any());
+        add_bytes(bytes, total);
+    }
+
+    // Bitboard::count_queen_moves(), added to total
+    static LANE_INLINE void add_queen_moves(const Lanes& gen, const Lanes& empty, word_t& total) {
+        add_sliding_moves<-BBWIDTH - 1>(gen, empty, total);
+        add_sliding_moves<-BBWIDTH>(gen, empty, total);
+        add_sliding_moves<-BBWIDTH + 1>(gen, empty, total);
+        add_sliding_moves<-1>(gen, empty, total);
+        add_sliding_moves<1>(gen, empty, total);
+        add_sliding_moves<BBWIDTH - 1>(gen, empty, total);
+        add_sliding_moves<BBWIDTH>(gen, empty, total);
+        add_sliding_moves<BBWIDTH + 1>(gen, empty, total);
+    }
+
+    // Bitboard::king_dilation()
+    static LANE_INLINE Lanes king_dilation(const Lanes& gen) {
+        Lanes row = gen | gen.template shifted<1>() | gen.template shifted<-1>();
+        return row | row.template shifted<BBWIDTH>() | row.template shifted<-BBWIDTH>();
+    }
+
+    // Bitboard::king_flood_fill(), until the fill has stopped in every lane
+    static LANE_INLINE Lanes king_flood_fill(const Lanes& gen, const Lanes& pro) {
+        Lanes filled = gen;
+        Lanes frontier = gen;
+
+        while(frontier.any()) {
+            frontier = king_dilation(frontier) & pro & ~filled;
+            filled |= frontier;
+        }
+        return filled;
+    }
+};
+
+/*
+ * classic_child_terms() for exactly N children, one per lane
+ *
+ * Params:
+ *     board - the position before the moves
+ *     player - the player making the moves
+ *     moves - N legal moves
+ *     move_diffs - filled with each child's difference in legal moves
+ *     access_diffs - filled with each child's difference in accessible squares
+ * Return: none
+ */
+template<int N>
+static LANE_INLINE void lane_terms(const Board& board, player_t player, const packed_move_t *moves,
+                                   int *move_diffs, int *access_diffs) {
+    typedef typename Lanes<N>::word_t word_t;
+    Bitboard occupied[N];
+    Bitboard amazons[2][N]; // indexed by player
+
+    for(int c=0; c < N; c++) {
+        packed_move_t move = moves[c];
+        occupied[c] = board.get_occupied();
+        occupied[c].reset(move_old_loc(move));
+        occupied[c].set(move_new_loc(move));
+        occupied[c].set(move_arrow(move));
+        amazons[player][c] = board.get_amazons(player);
+        amazons[player][c].reset(move_old_loc(move));
+        amazons[player][c].set(move_new_loc(move));
+        amazons[!player][c] = board.get_amazons(!player);
+    }
+
+    Lanes<N> empty = ~Lanes<N>::load(occupied);
+    word_t num_moves[2];
+    word_t accessible[2];
+    for(int p=0; p < 2; p++) {
+        int squares[AMAZONS_PER_PLAYER][N];
+        for(int c=0; c < N; c++) {
+            Bitboard remaining = amazons[p][c];
+            for(int k=0; k < AMAZONS_PER_PLAYER; k++)
+                squares[k][c] = remaining.pop_lowest();
+        }
+
+        // Board::count_amazon_moves() for the kth amazon of every lane
+        num_moves[p] = word_t{};
+        for(int k=0; k < AMAZONS_PER_PLAYER; k++) {
+            Lanes<N> amazon = Lanes<N>::square(squares[k]);
+            Lanes<N> destinations = Lanes<N>::queen_attacks(amazon, empty);
+            Lanes<N>::add_queen_moves(destinations, empty | amazon, num_moves[p]);
+        }
+        accessible[p] = word_t{};
+        Lanes<N>::king_flood_fill(Lanes<N>::load(amazons[p]), empty).add_count(accessible[p]);
+    }
+
+    for(int c=0; c < N; c++) {
+        move_diffs[c] = (int)Lanes<N>::lane(num_moves[LEFT], c) - (int)Lanes<N>::lane(num_moves[RIGHT], c);
+        access_diffs[c] = (int)Lanes<N>::lane(accessible[LEFT], c) - (int)Lanes<N>::lane(accessible[RIGHT], c);
+    }
+}
+
+// classic_child_terms() N children at a time
+template<int N>
+static LANE_INLINE void all_lane_terms(const Board& board, player_t player, const packed_move_t *moves,
+                                       int num_moves, int *move_diffs, int *access_diffs) {
+    int i = 0;
+    for(; i + N <= num_moves; i += N) {
+        lane_terms<N>(board, player, moves + i, move_diffs + i, access_diffs + i);
+    }
+    if(i == num_moves)
+        return;
+
+    // the last few children, with the spare lanes repeating the last move
+    packed_move_t tail[N];
+    int tail_move_diffs[N];
+    int tail_access_diffs[N];
+    for(int c=0; c < N; c++) {
+        tail[c] = moves[std::min(i + c, num_moves - 1)];
+    }
+    lane_terms<N>(board, player, tail, tail_move_diffs, tail_access_diffs);
+    for(int c=0; i + c < num_moves; c++) {
+        move_diffs[i + c] = tail_move_diffs[c];
+        access_diffs[i + c] = tail_access_diffs[c];
+    }
+}
+
+typedef void (*lane_kernel_t)(const Board&, player_t, const packed_move_t *, int, int *, int *);
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static void avx2_terms(const Board& board, player_t player, const packed_move_t *moves, int num_moves,
+                       int *move_diffs, int *access_diffs) {
+    all_lane_terms<4>(board, player, moves, num_moves, move_diffs, access_diffs);
+}
+
+__attribute__((target("sse2")))
+static void sse2_terms(const Board& board, player_t player, const packed_move_t *moves, int num_moves,
+                       int *move_diffs, int *access_diffs) {
+    all_lane_terms<2>(board, player, moves, num_moves, move_diffs, access_diffs);
+}
+#endif
+
+static void scalar_terms(const Board& board, player_t player, const packed_move_t *moves, int num_moves,
+                         int *move_diffs, int *access_diffs) {
+    all_lane_terms<1>(board, player, moves, num_moves, move_diffs, access_diffs);
+}
+
+static int kernel_lanes = 1;
+
+// picks the widest kernel the processor runs. Run once, before main()
+static lane_kernel_t pick_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        kernel_lanes = 4;
+        return avx2_terms;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        kernel_lanes = 2;
+        return sse2_terms;
+    }
+#endif
+    kernel_lanes = 1;
+    return scalar_terms;
+}
+
+static const lane_kernel_t kernel = pick_kernel();
+
+/*
+ * The classic terms of the position after each of a list of moves: left's
+ * legal moves minus right's, and left's accessible squares minus right's,
+ * as Board::find_num_moves() and Board::count_accessible_squares() count
+ * them on the board the move leads to
+ *
+ * Params:
+ *     board - the position before the moves
+ *     player - the player making the moves
+ *     moves - the moves, each legal
+ *     num_moves - the length of moves
+ *     move_diffs - filled with each child's difference in legal moves
+ *     access_diffs - filled with each child's difference in accessible squares
+ * Return: none
+ */
+void classic_child_terms(const Board& board, player_t player, const packed_move_t *moves, int num_moves,
+                         int *move_diffs, int *access_diffs) {
+    kernel(board, player, moves, num_moves, move_diffs, access_diffs);
+
+#ifdef EVAL_CROSSCHECK
+    for(int i=0; i < num_moves; i++) {
+        Board child = board;
+        child.do_move(player, moves[i]);
+        int move_diff = child.find_num_moves(LEFT) - child.find_num_moves(RIGHT);
+        int access_diff = child.count_accessible_squares(LEFT) - child.count_accessible_squares(RIGHT);
+        if(move_diffs[i] != move_diff || access_diffs[i] != access_diff) {
+            fprintf(stderr, "classic_child_terms: %d lanes gave moves %d access %d for child %d, "
+                            "Board gives moves %d access %d\n",
+                    kernel_lanes, move_diffs[i], access_diffs[i], i, move_diff, access_diff);
+            abort();
+        }
+    }
+#endif
+}
+
+// the number of children classic_child_terms() works on at once on this processor
+int batch_lanes() {
+    return kernel_lanes;
+}
+
+} // namespace BOARD_NAMESPACE
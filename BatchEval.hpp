@@ -0,0 +1,43 @@
+#ifndef BATCHEVAL_H
+#define BATCHEVAL_H
+
+// The classic heuristic's terms for many children of one position at once.
+// The children's bitboards are laid side by side, one child per 64 bit
+// lane, so that every shift and mask of the sliding attacks and the flood
+// fills works on several children with one instruction. The widest lanes
+// the processor has are picked once, at startup: four children at a time
+// with AVX2, two with SSE2, and one at a time otherwise. The terms are
+// exact counts, so they are the same whichever width is picked, and the
+// same as Board's. Alpha-beta orders its moves with them, and puct_policy
+// compares the priors of the moves a tree node may open next with them.
+// Compile with -DEVAL_CROSSCHECK to check every batch against Board
+
+#include "amazons.hpp"
+#include "Board.hpp"
+
+namespace BOARD_NAMESPACE {
+
+/*
+ * The classic terms of the position after each of a list of moves: left's
+ * legal moves minus right's, and left's accessible squares minus right's,
+ * as Board::find_num_moves() and Board::count_accessible_squares() count
+ * them on the board the move leads to
+ *
+ * Params:
+ *     board - the position before the moves
+ *     player - the player making the moves
+ *     moves - the moves, each legal
+ *     num_moves - the length of moves
+ *     move_diffs - filled with each child's difference in legal moves
+ *     access_diffs - filled with each child's difference in accessible squares
+ * Return: none
+ */
+void classic_child_terms(const Board& board, player_t player, const packed_move_t *moves, int num_moves,
+                         int *move_diffs, int *access_diffs);
+
+// the number of children classic_child_terms() works on at once on this processor
+int batch_lanes();
+
+} // namespace BOARD_NAMESPACE
+
+#endif
@@ -0,0 +1,344 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+// A fixed width bitboard built from raw 64 bit words, with the shift based
+// sliding attack generators used by Board. Everything here is inline, since
+// it is the innermost loop of the AI
+
+#include <stdint.h>
+#include "amazons.hpp"
+
+namespace BOARD_NAMESPACE {
+
+// the number of 64 bit words needed to hold SETSIZE bits
+// (64 bits for 6x6, 128 for 8x8, 192 for 10x10)
+#define BBWORDS ((SETSIZE + 63) / 64)
+
+// the bits of the last word which correspond to real squares
+#define LAST_WORD_MASK ((SETSIZE % 64 == 0) ? ~0ULL : (1ULL << (SETSIZE % 64)) - 1)
+#define LAST_WORD ((SETSIZE - 1) / 64)
+
+class Bitboard {
+    uint64_t words[BBWORDS];
+
+    public:
+    Bitboard() {
+        for(int i=0; i < BBWORDS; i++)
+            words[i] = 0;
+    }
+
+    // the bitboard with only the passed square set
+    static inline Bitboard square(int index) {
+        Bitboard bb;
+        bb.set(index);
+        return bb;
+    }
+
+    //////////////////  BITSET STYLE ACCESS  //////////////////
+
+    bool operator[](int index) const {return (words[index >> 6] >> (index & 63)) & 1;}
+    void set(int index) {words[index >> 6] |= 1ULL << (index & 63);}
+    void reset(int index) {words[index >> 6] &= ~(1ULL << (index & 63));}
+    void flip(int index) {words[index >> 6] ^= 1ULL << (index & 63);}
+
+    void reset() {
+        for(int i=0; i < BBWORDS; i++)
+            words[i] = 0;
+    }
+
+    // the ith 64 bit word, holding squares 64 * i to 64 * i + 63
+    uint64_t word(int i) const {return words[i];}
+
+    bool any() const {
+        uint64_t acc = 0;
+        for(int i=0; i < BBWORDS; i++)
+            acc |= words[i];
+        return acc != 0;
+    }
+
+    int count() const {
+        int total = 0;
+        for(int i=0; i < BBWORDS; i++)
+            total += __builtin_popcountll(words[i]);
+        return total;
+    }
+
+    // the index of the lowest set bit. Precondition: any() is true
+    int lowest() const {
+        int i = 0;
+        while(words[i] == 0) i++;
+        return (i << 6) + __builtin_ctzll(words[i]);
+    }
+
+    // the index of the nth lowest set bit (counting from 0). Precondition: n < count()
+    int nth_set(int n) const {
+        int i = 0;
+        int in_word;
+        while(n >= (in_word = __builtin_popcountll(words[i]))) {
+            n -= in_word;
+            i++;
+        }
+        uint64_t word = words[i];
+        for(; n > 0; n--)
+            word &= word - 1;
+        return (i << 6) + __builtin_ctzll(word);
+    }
+
+    // clears the lowest set bit and returns its index. Precondition: any() is true
+    int pop_lowest() {
+        int i = 0;
+        while(words[i] == 0) i++;
+        int index = (i << 6) + __builtin_ctzll(words[i]);
+        words[i] &= words[i] - 1;
+        return index;
+    }
+
+    //////////////////  SET OPERATIONS  //////////////////
+
+    Bitboard& operator|=(const Bitboard& other) {
+        for(int i=0; i < BBWORDS; i++)
+            words[i] |= other.words[i];
+        return *this;
+    }
+
+    Bitboard& operator&=(const Bitboard& other) {
+        for(int i=0; i < BBWORDS; i++)
+            words[i] &= other.words[i];
+        return *this;
+    }
+
+    Bitboard& operator^=(const Bitboard& other) {
+        for(int i=0; i < BBWORDS; i++)
+            words[i] ^= other.words[i];
+        return *this;
+    }
+
+    Bitboard operator|(const Bitboard& other) const {Bitboard r(*this); return r |= other;}
+    Bitboard operator&(const Bitboard& other) const {Bitboard r(*this); return r &= other;}
+    Bitboard operator^(const Bitboard& other) const {Bitboard r(*this); return r ^= other;}
+
+    // complement, restricted to the SETSIZE real bits
+    Bitboard operator~() const {
+        Bitboard r;
+        for(int i=0; i < BBWORDS; i++)
+            r.words[i] = ~words[i];
+        r.words[LAST_WORD] &= LAST_WORD_MASK;
+        for(int i=LAST_WORD + 1; i < BBWORDS; i++)
+            r.words[i] = 0;
+        return r;
+    }
+
+    bool operator==(const Bitboard& other) const {
+        for(int i=0; i < BBWORDS; i++)
+            if(words[i] != other.words[i]) return false;
+        return true;
+    }
+
+    bool operator!=(const Bitboard& other) const {return !(*this == other);}
+
+    // mixes the words into one 64 bit value, for hash tables keyed by bitboards
+    uint64_t hash() const {
+        uint64_t h = 0;
+        for(int i=0; i < BBWORDS; i++)
+            h = (h ^ words[i]) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 29);
+    }
+
+    /*
+     * Moves every bit from index i to index i + N. Bits pushed off either end
+     * are lost. N is a template parameter so that the word and bit offsets
+     * constant fold
+     *
+     * Params: none
+     * Return: the shifted bitboard
+     */
+    template<int N>
+    Bitboard shifted() const {
+        Bitboard r;
+        if(N >= 0) {
+            const int word_shift = N / 64;
+            const int bit_shift = N % 64;
+            for(int i=BBWORDS - 1; i >= word_shift; i--) {
+                uint64_t w = words[i - word_shift] << bit_shift;
+                if(bit_shift != 0 && i - word_shift - 1 >= 0)
+                    w |= words[i - word_shift - 1] >> ((64 - bit_shift) & 63);
+                r.words[i] = w;
+            }
+        } else {
+            const int word_shift = (-N) / 64;
+            const int bit_shift = (-N) % 64;
+            for(int i=0; i + word_shift < BBWORDS; i++) {
+                uint64_t w = words[i + word_shift] >> bit_shift;
+                if(bit_shift != 0 && i + word_shift + 1 < BBWORDS)
+                    w |= words[i + word_shift + 1] << ((64 - bit_shift) & 63);
+                r.words[i] = w;
+            }
+        }
+        return r;
+    }
+
+    //////////////////  SLIDING ATTACKS  //////////////////
+
+    /*
+     * Kogge-Stone occluded fill. Extends every bit of gen along direction S
+     * for as long as it stays inside pro (the propagator set, usually the
+     * empty squares). Because the board is surrounded by an occupied border,
+     * rays can never wrap around from one edge to the other
+     *
+     * Params:
+     *     gen - the squares to fill from
+     *     pro - the squares the fill may pass through
+     * Return: gen plus every square reachable from it along direction S
+     */
+    template<int S>
+    static inline Bitboard occluded_fill(Bitboard gen, Bitboard pro) {
+        gen |= pro & gen.shifted<S>();
+        pro &= pro.shifted<S>();
+        gen |= pro & gen.shifted<2 * S>();
+        pro &= pro.shifted<2 * S>();
+        gen |= pro & gen.shifted<4 * S>();
+        if(BOARDWIDTH - 1 > 7) { // rays can be longer than 1 + 2 + 4 squares
+            pro &= pro.shifted<4 * S>();
+            gen |= pro & gen.shifted<8 * S>();
+        }
+        return gen;
+    }
+
+    // the empty squares a queen on any square of gen could slide to along direction S
+    template<int S>
+    static inline Bitboard sliding_attacks(const Bitboard& gen, const Bitboard& empty) {
+        return occluded_fill<S>(gen, empty).template shifted<S>() & empty;
+    }
+
+    /*
+     * The squares a chess queen on any square of gen could move to, in all
+     * eight INCRS_INIT directions
+     *
+     * Params:
+     *     gen - the squares the queens start on
+     *     empty - the unoccupied squares
+     * Return: the union of the squares each queen can reach in one move
+     */
+    static inline Bitboard queen_attacks(const Bitboard& gen, const Bitboard& empty) {
+        return sliding_attacks<-BBWIDTH - 1>(gen, empty)
+             | sliding_attacks<-BBWIDTH>(gen, empty)
+             | sliding_attacks<-BBWIDTH + 1>(gen, empty)
+             | sliding_attacks<-1>(gen, empty)
+             | sliding_attacks<1>(gen, empty)
+             | sliding_attacks<BBWIDTH - 1>(gen, empty)
+             | sliding_attacks<BBWIDTH>(gen, empty)
+             | sliding_attacks<BBWIDTH + 1>(gen, empty);
+    }
+
+    // the squares along direction S a queen on any square of gen could slide to,
+    // plus the square that stops each ray
+    template<int S>
+    static inline Bitboard sliding_reach(const Bitboard& gen, const Bitboard& empty) {
+        return occluded_fill<S>(gen, empty).template shifted<S>();
+    }
+
+    /*
+     * gen, plus every square a queen on a square of gen could move to, plus
+     * the square that stops each of its rays. A change to any square of the
+     * result can change the queen moves available from gen, and nothing else can
+     *
+     * Params:
+     *     gen - the squares the queens start on
+     *     empty - the unoccupied squares
+     * Return: gen and the squares it sees, blockers included
+     */
+    static inline Bitboard queen_reach(const Bitboard& gen, const Bitboard& empty) {
+        return gen
+             | sliding_reach<-BBWIDTH - 1>(gen, empty)
+             | sliding_reach<-BBWIDTH>(gen, empty)
+             | sliding_reach<-BBWIDTH + 1>(gen, empty)
+             | sliding_reach<-1>(gen, empty)
+             | sliding_reach<1>(gen, empty)
+             | sliding_reach<BBWIDTH - 1>(gen, empty)
+             | sliding_reach<BBWIDTH>(gen, empty)
+             | sliding_reach<BBWIDTH + 1>(gen, empty);
+    }
+
+    /*
+     * Counts the squares along direction S that each square of gen can slide
+     * to, summed over all of gen. Steps the whole set one square at a time,
+     * so each bit of step k is the kth square of one unobstructed ray
+     *
+     * Params:
+     *     gen - the squares to slide from
+     *     empty - the unoccupied squares
+     * Return: the total length of the rays from gen in direction S
+     */
+    template<int S>
+    static inline int count_sliding_moves(Bitboard gen, const Bitboard& empty) {
+        int count = 0;
+        int step;
+        do {
+            gen = gen.template shifted<S>() & empty;
+            step = gen.count();
+            count += step;
+        } while(step != 0);
+        return count;
+    }
+
+    /*
+     * Counts the moves a chess queen would have from each square of gen,
+     * summed over all of gen. Equivalent to summing queen_attacks(square).count()
+     * over the squares of gen, but without splitting gen into single squares
+     *
+     * Params:
+     *     gen - the squares the queens start on
+     *     empty - the unoccupied squares
+     * Return: the total number of queen moves from the squares of gen
+     */
+    static inline int count_queen_moves(const Bitboard& gen, const Bitboard& empty) {
+        return count_sliding_moves<-BBWIDTH - 1>(gen, empty)
+             + count_sliding_moves<-BBWIDTH>(gen, empty)
+             + count_sliding_moves<-BBWIDTH + 1>(gen, empty)
+             + count_sliding_moves<-1>(gen, empty)
+             + count_sliding_moves<1>(gen, empty)
+             + count_sliding_moves<BBWIDTH - 1>(gen, empty)
+             + count_sliding_moves<BBWIDTH>(gen, empty)
+             + count_sliding_moves<BBWIDTH + 1>(gen, empty);
+    }
+
+    //////////////////  KING MOVES  //////////////////
+
+    /*
+     * The squares a chess king on any square of gen could step to, ignoring
+     * occupancy. Spreads sideways first, then up and down, so that four
+     * shifts cover all eight neighbours
+     *
+     * Params:
+     *     gen - the squares the kings start on
+     * Return: gen and every square next to it
+     */
+    static inline Bitboard king_dilation(const Bitboard& gen) {
+        Bitboard row = gen | gen.shifted<1>() | gen.shifted<-1>();
+        return row | row.shifted<BBWIDTH>() | row.shifted<-BBWIDTH>();
+    }
+
+    /*
+     * Flood fills outwards from gen in king steps through the squares of
+     * pro, one layer per pass, until no new square is reached
+     *
+     * Params:
+     *     gen - the squares to fill from
+     *     pro - the squares the fill may spread to
+     * Return: gen plus every square of pro connected to it by king steps
+     */
+    static inline Bitboard king_flood_fill(const Bitboard& gen, const Bitboard& pro) {
+        Bitboard filled = gen;
+        Bitboard frontier = gen;
+
+        while(frontier.any()) {
+            frontier = king_dilation(frontier) & pro & ~filled;
+            filled |= frontier;
+        }
+        return filled;
+    }
+};
+
+} // namespace BOARD_NAMESPACE
+
+#endif
@@ -1,64 +1,97 @@
 // Definitions of Board methods
 
-#include <bitset>
-#include <vector>
-#include <list>
+#include <algorithm>
 #include <assert.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include "amazons.hpp"
 #include "Board.hpp"
 #include "UI.hpp"
 
+namespace BOARD_NAMESPACE {
+
+#define ZOBRIST_ARROW 2 // the row of ZOBRIST.keys for arrows. Amazons use their player_t
+
+/*
+ * The Zobrist keys: a random 64 bit number for each kind of piece on each
+ * square, worked out by splitmix64 at compile time
+ */
+struct ZobristKeys {
+    uint64_t keys[3][SETSIZE]; // right amazon, left amazon, arrow
+
+    constexpr ZobristKeys() : keys() {
+        uint64_t state = ZOBRIST_SEED;
+        for(int piece=0; piece < 3; piece++) {
+            for(int i=0; i < SETSIZE; i++) {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                keys[piece][i] = z ^ (z >> 31);
+            }
+        }
+    }
+};
+
+static constexpr ZobristKeys ZOBRIST;
+
+// whether the passed index is on the border around the board
+static inline bool on_border(int i) {
+    return i < BBWIDTH || i >= SETSIZE - BBWIDTH || i % BBWIDTH == 0 || i % BBWIDTH == BBWIDTH - 1;
+}
+
 // initializes board to start position
 Board::Board() {
     //fill border with 1's
     for(int i=0; i < SETSIZE; i++) {
-        if(i < BBWIDTH || i >= SETSIZE - BBWIDTH || i % BBWIDTH == 0 || i % BBWIDTH == BBWIDTH - 1) //is on border
+        if(on_border(i))
             occupied.set(i);
         else
             occupied.reset(i);
     }
-    //fill left and right starting positions
-    if(BOARDWIDTH == 10) {
-        left_amazons.set(16);
-        left_amazons.set(19);
-        left_amazons.set(49);
-        left_amazons.set(58);
-        right_amazons.set(85);
-        right_amazons.set(94);
-        right_amazons.set(124);
-        right_amazons.set(127);
-    }
-    if(BOARDWIDTH == 8) {
-        left_amazons.set(21);
-        left_amazons.set(38);
-        left_amazons.set(15);
-        right_amazons.set(61);
-        right_amazons.set(78);
-        right_amazons.set(84);
-    }
-    if(BOARDWIDTH == 6) {
-        left_amazons.set(10);
-        left_amazons.set(22);
-        right_amazons.set(53);
-        right_amazons.set(41);
+    //fill left's starting positions, and right's, which mirror them through the centre
+    const int left_start[AMAZONS_PER_PLAYER][2] = LEFT_START_SQUARES;
+    for(int i=0; i < AMAZONS_PER_PLAYER; i++) {
+        int index = left_start[i][0] * BBWIDTH + left_start[i][1];
+        left_amazons.set(index);
+        right_amazons.set(SETSIZE - 1 - index);
     }
 
     //include amazons in occupied
     occupied |= left_amazons;
     occupied |= right_amazons;
+
+    hash = compute_hash();
 }
 
 // copy constructor
 Board::Board(const Board& to_copy) {
-    // using |= not = so as to avoid ailiasing weirdness
-    this->occupied.reset();
-    this->occupied |= to_copy.occupied;
-    this->left_amazons.reset();
-    this->left_amazons |= to_copy.left_amazons;
-    this->right_amazons.reset();
-    this->right_amazons |= to_copy.right_amazons;
+    this->occupied = to_copy.occupied;
+    this->left_amazons = to_copy.left_amazons;
+    this->right_amazons = to_copy.right_amazons;
+    this->hash = to_copy.hash;
+}
+
+/*
+ * Hashes the pieces on the board from scratch. make_move() keeps
+ * get_hash() equal to this without redoing it
+ *
+ * Params: none
+ * Return: a uint64_t - the xor of the Zobrist keys of every amazon and arrow
+ */
+uint64_t Board::compute_hash() const {
+    uint64_t h = 0;
+
+    for(int i=0; i < SETSIZE; i++) {
+        if(left_amazons[i])
+            h ^= ZOBRIST.keys[LEFT][i];
+        else if(right_amazons[i])
+            h ^= ZOBRIST.keys[RIGHT][i];
+        else if(occupied[i] && !on_border(i))
+            h ^= ZOBRIST.keys[ZOBRIST_ARROW][i];
+    }
+    return h;
 }
 
 /*
@@ -122,15 +155,16 @@ bool Board::queen_connected(Point start, Point end) const {
  * Returns:
  *     a bool - true if the move is legal, false otherwise
  */
-bool Board::move_is_legal(player_t player, move_t move) {
+bool Board::move_is_legal(player_t player, packed_move_t move) {
     bool legal;
-    int start_index = move.old_loc.to_bbval();
+    int start_index = move_old_loc(move);
+    Point new_loc(move_new_loc(move));
 
     if(!has_amazon(player, start_index)) // player does not have amazon there
         return false;
 
     occupied.flip(start_index); // so it doesn't think the queen's old position is blocking the arrow
-    legal = queen_connected(move.old_loc, move.new_loc) && queen_connected(move.new_loc, move.arrow);
+    legal = queen_connected(Point(start_index), new_loc) && queen_connected(new_loc, Point(move_arrow(move)));
     occupied.flip(start_index); // so that this method doesn't mutate the board
     return legal;
 }
@@ -145,60 +179,88 @@ bool Board::move_is_legal(player_t player, move_t move) {
  * Returns:
  *     a bool - true if the move is legal, false otherwise
  */
-bool Board::make_move(player_t player, move_t move) {
+bool Board::make_move(player_t player, packed_move_t move) {
     if(!move_is_legal(player, move))
         return false;
 
-    int start = move.old_loc.to_bbval();
-    int finish = move.new_loc.to_bbval();
-    int to_burn = move.arrow.to_bbval();
+    do_move(player, move);
+    return true;
+}
+
+/*
+ * Makes a move without checking that it is legal. For the AI, whose moves
+ * all come from the move generators
+ *
+ * Precondition: the move is legal
+ *
+ * Params:
+ *     player - which player is making the move (left or right)
+ *     move - the move to make
+ * Returns: none
+ */
+void Board::do_move(player_t player, packed_move_t move) {
+    int start = move_old_loc(move);
+    int finish = move_new_loc(move);
+    int to_burn = move_arrow(move);
+
+#ifdef EVAL_CROSSCHECK
+    if(!move_is_legal(player, move)) {
+        fprintf(stderr, "Board do_move: illegal move %d-%d (%d)\n", start, finish, to_burn);
+        abort();
+    }
+#endif
 
     flip_amazon(player, start);
     flip_amazon(player, finish);
     occupied.reset(start);
     occupied.set(finish);
     occupied.set(to_burn);
+    hash ^= ZOBRIST.keys[player][start] ^ ZOBRIST.keys[player][finish] ^ ZOBRIST.keys[ZOBRIST_ARROW][to_burn];
 
-    return true;
+#ifdef EVAL_CROSSCHECK
+    if(hash != compute_hash()) {
+        fprintf(stderr, "Board do_move: the Zobrist hash differs from a full recount\n");
+        abort();
+    }
+#endif
 }
 
 /*
- * Returns the board resulting from making a certain move on this board,
- * without altering this board.
+ * Takes back the last move made with do_move() or make_move()
  *
- * Precondition: the move passed is a legal one
+ * Precondition: move is the last move made on this board, by player
  *
  * Params:
- *     player - which player is trying to make the move (left or right)
- *     move - the move the player is trying to make
- * Returns:
- *     a Board object representing the board after the move is played
+ *     player - which player made the move (left or right)
+ *     move - the move to take back
+ * Returns: none
  */
-Board Board::make_move_immutably(player_t player, move_t move) {
-    Board moved_board(*this);
-    assert(moved_board.make_move(player, move));
-    return moved_board;
+void Board::undo_move(player_t player, packed_move_t move) {
+    int start = move_old_loc(move);
+    int finish = move_new_loc(move);
+    int to_burn = move_arrow(move);
+
+    // the arrow comes off first, since it may have been shot into start
+    occupied.reset(to_burn);
+    occupied.reset(finish);
+    occupied.set(start);
+    flip_amazon(player, finish);
+    flip_amazon(player, start);
+    hash ^= ZOBRIST.keys[player][start] ^ ZOBRIST.keys[player][finish] ^ ZOBRIST.keys[ZOBRIST_ARROW][to_burn];
 }
 
 /*
- * Determines if the passed player has any legal moves
+ * Determines if the passed player has any legal moves. An amazon with an
+ * empty square next to her can always move there and shoot back at the
+ * square she left, so this is one mask of the squares around the amazons
  *
  * Params:
  *     player - which player we're checking for moves
  * Return:
  *     a bool - true if the player is out of moves, false if they can still move
  */
-bool Board::no_moves(player_t player) {
-    // the increments to get to adjacent squares
-    int incrs[8] = INCRS_INIT; 
-
-    for(int i=TOP_LEFT; i<=BOTTOM_RIGHT; i++) // for each square on the board
-        if(has_amazon(player, i)) // if this player has an amazon there
-            for(int j=0; j < 8; j++) // look at all the adjacent squares
-                if(!occupied[i+incrs[j]]) // if one is unoccupied
-                    return false; // the player has a move
-
-    return true;
+bool Board::no_moves(player_t player) const {
+    return !(Bitboard::king_dilation(amazons_of(player)) & ~occupied).any();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -257,7 +319,7 @@ void Board::print() {
  * Finds the number of squares a chess queen could move to if it was on the 
  * square corresponding to index
  *
- * Note: could just call queen_reachables and take length, but doesn't for
+ * Note: could just call queen_attacks and take count, but doesn't for
  *       performance reasons. Needs to be fast so AI can consider as many
  *       moves as possible
  *
@@ -267,16 +329,7 @@ void Board::print() {
  *     A count of how many distinct legal moves the queen would have
  */
 int Board::num_queen_connections(int index) {
-    int count = 0;
-    int incrs[8] = INCRS_INIT;
-
-    for(int i=0; i<8; i++) {
-        int j;
-        for(j=1; !occupied[index + j * incrs[i]]; j++);
-        count += j - 1;
-    }
-
-    return count;
+    return Bitboard::count_queen_moves(Bitboard::square(index), ~occupied);
 }
 
 /*
@@ -289,19 +342,11 @@ int Board::num_queen_connections(int index) {
  *     an int - the number of distinct moves the amazon can make on this board
  */
 int Board::count_amazon_moves(int index) {
-    int count = 0;
-    int incrs[8] = INCRS_INIT;
-    int current;
-
-    for(int i=0; i<8; i++) {
-        for(int j=1; !occupied[(current = index + j * incrs[i])]; j++) {
-            occupied.flip(index); // so the amazon doesn't get in the way of her arrow
-            count += num_queen_connections(current);
-            occupied.flip(index); // to avoid mutating the board
-        }
-    }
+    Bitboard empty = ~occupied;
+    Bitboard destinations = Bitboard::queen_attacks(Bitboard::square(index), empty);
 
-    return count;
+    empty.set(index); // so the amazon doesn't get in the way of her arrow
+    return Bitboard::count_queen_moves(destinations, empty);
 }
 
 /*
@@ -320,209 +365,157 @@ int Board::count_amazon_moves(int index) {
  *              if going next
  */
 int Board::find_num_moves(player_t player) {
+    Bitboard amazons = amazons_of(player);
     int count = 0;
 
-    for(int i=TOP_LEFT; i<=BOTTOM_RIGHT; i++) {
-        if(has_amazon(player, i)) {
-            count += count_amazon_moves(i);
-        }
+    while(amazons.any()) {
+        count += count_amazon_moves(amazons.pop_lowest());
     }
 
     return count;
-} 
+}
 
 /*
- * Helper for evaluate
- * Returns a count of the number of squares a player can reach by repeatedly
- * moving their amazons like chess kings
+ * fills a caller supplied list with all possible moves for a player on this
+ * board. Does no heap allocation
  *
- * Params:
- *     player - the player whose accesibility we're measuring
- * Return:
- *     an int - the count of how many squares are accessible to this player
+ * Params: 
+ *     player - the player for whom we're compiling moves
+ *     moves - the list to fill. Anything already in it is discarded
+ * Returns: none
  */
-int Board::count_accessible_squares(player_t player) {
-    std::bitset<SETSIZE> accesible;
-    std::bitset<SETSIZE> fresh;
-    std::bitset<SETSIZE> newly_accesible;
-    int incrs[8] = INCRS_INIT;
-
-    for(int i=TOP_LEFT; i<=BOTTOM_RIGHT; i++) {
-        if(has_amazon(player, i)) {
-            fresh.set(i);
-        }
-    }
-
-    accesible |= fresh;
-
-    while(fresh.any()) { // while we still have squares to search from
-        for(int i=TOP_LEFT; i<=BOTTOM_RIGHT; i++) {
-            if(fresh[i]) { // for each fresh square
-                for(int j=0; j<8; j++) { // for each of its neighbors
-                    if(!accesible[i + incrs[j]] && // if it's not already added
-                        !occupied[i + incrs[j]]) { // and not occupied
-                        newly_accesible.set(i + incrs[j]); // we've found a new square
-                    }
-                }
+void Board::get_moves(player_t player, MoveList& moves) {
+    Bitboard amazons = amazons_of(player);
+    Bitboard empty = ~occupied;
+
+    moves.clear();
+    while(amazons.any()) {
+        int amazon = amazons.pop_lowest();
+        Bitboard destinations = Bitboard::queen_attacks(Bitboard::square(amazon), empty);
+
+        empty.set(amazon); // so the amazon doesn't get in the way of her arrow
+        while(destinations.any()) {
+            int new_loc = destinations.pop_lowest();
+            Bitboard arrows = Bitboard::queen_attacks(Bitboard::square(new_loc), empty);
+            while(arrows.any()) {
+                moves.push(pack_move(amazon, new_loc, arrows.pop_lowest()));
             }
         }
-        accesible |= newly_accesible;
-        fresh.reset();
-        fresh |= newly_accesible;
-        newly_accesible.reset();
+        empty.reset(amazon);
     }
-
-    return accesible.count();
-}
-
-/*
- * A heuristic which estimates which player the position is more favorable for
- * Positive values are better for left; negative are better for right
- * 
- * Params: none
- * Return:
- *     an int - the more positive, the better for left
- *              the more negative, the better for right
- */
-int Board::evaluate() {
-    int num_moves_diff = find_num_moves(LEFT) - find_num_moves(RIGHT);
-    int accesible_squares_diff = count_accessible_squares(LEFT) - count_accessible_squares(RIGHT);
-
-    return num_moves_diff + ALPHA * accesible_squares_diff;
-}
-
-// same as evaluate(), but prints additional info to stdout
-int Board::evaluate_verbose() {
-    int left_moves = find_num_moves(LEFT);
-    int right_moves = find_num_moves(RIGHT);
-    int num_moves_diff = left_moves - right_moves;
-    int left_accesible = count_accessible_squares(LEFT);
-    int right_accessible = count_accessible_squares(RIGHT);
-    int accesible_squares_diff = left_accesible - right_accessible;
-    int eval = num_moves_diff + ALPHA * accesible_squares_diff;
-
-    printf("left moves: %i\n", left_moves);
-    printf("right moves: %i\n", right_moves);
-    printf("left access: %i\n", left_accesible);
-    printf("right access: %i\n", right_accessible);
-    printf("Final eval: %i\n", eval);
-    return eval;
 }
 
 /*
- * Evaluates the position that would result from the playing of a passed move,
- * using a basic heuristic
+ * Finds the nth move that the amazon on the passed square can make, in
+ * the order get_moves() lists them. Skips whole destinations using their
+ * arrow counts, so it never builds the move list
+ *
+ * Precondition: 0 <= n < count_amazon_moves(index)
  *
  * Params:
- *     player - the player who would make the move
- *     move - the move after which we want to evaluate
+ *     index - the index in the bitboard of the square the amazon starts at
+ *     n - the position of the move among this amazon's moves
  * Return:
- *     an int - the evaluation of the resulting position
+ *     a packed_move_t - the nth move of that amazon
  */
-int Board::evaluate(player_t player, move_t move) {
-    Board edited_board = make_move_immutably(player, move);
-    return edited_board.evaluate();
-}
+packed_move_t Board::nth_amazon_move(int index, int n) {
+    Bitboard empty = ~occupied;
+    Bitboard destinations = Bitboard::queen_attacks(Bitboard::square(index), empty);
+
+    empty.set(index); // so the amazon doesn't get in the way of her arrow
+    while(destinations.any()) {
+        int new_loc = destinations.pop_lowest();
+        Bitboard arrows = Bitboard::queen_attacks(Bitboard::square(new_loc), empty);
+        int num_arrows = arrows.count();
+
+        if(n < num_arrows)
+            return pack_move(index, new_loc, arrows.nth_set(n));
+        n -= num_arrows;
+    }
 
-// same as evaluate(), but prints additional info to stdout
-int Board::evaluate_verbose(player_t player, move_t move) {
-    Board edited_board = make_move_immutably(player, move);
-    return edited_board.evaluate_verbose();
+    assert(false); // n was out of range
+    return NO_MOVE;
 }
 
 /*
- * Helper for get_moves()
- * Constructs a list of points that a chess queen could move to starting from
- * the passed square
+ * Finds the nth move in the list get_moves() would construct, without 
+ * constructing it. Skips whole amazons using count_amazon_moves()
+ *
+ * Precondition: 0 <= n < find_num_moves(player)
  *
  * Params:
- *     start - the starting square
+ *     player - the player whose moves we're indexing
+ *     n - the position of the move in the list
  * Return:
- *     a list of points - the points a queen at start could move to
+ *     a packed_move_t - the nth move
  */
-std::list<Point> Board::queen_reachables(Point start) {
-    std::list<Point> options;
-    int incrs[8] = INCRS_INIT;
-    int start_index = start.to_bbval();
-    int current_index;
+packed_move_t Board::nth_move(player_t player, int n) {
+    Bitboard amazons = amazons_of(player);
 
-    for(int i=0; i<8; i++) {
-        for(int j=1; !occupied[(current_index = start_index + j * incrs[i])]; j++) {
-            options.push_back(Point(current_index));
-        }
+    while(amazons.any()) {
+        int amazon = amazons.pop_lowest();
+        int amazon_moves = count_amazon_moves(amazon);
+
+        if(n < amazon_moves)
+            return nth_amazon_move(amazon, n);
+        n -= amazon_moves;
     }
-    return options;
+
+    assert(false); // n was out of range
+    return NO_MOVE;
 }
 
 /*
- * Helper for get_moves()
- * constructs a list of the point locations of a player's amazons
+ * Same as nth_move(), for a caller that already knows how many moves
+ * each of player's amazons has, so none are counted again
+ *
+ * Precondition: 0 <= n < the sum of amazon_moves
  *
  * Params:
- *     player - the player whose amazons we want
+ *     player - the player whose moves we're indexing
+ *     n - the position of the move in the list
+ *     amazon_moves - the move count of each of player's amazons, from
+ *                    the lowest square to the highest
  * Return:
- *     a list of points - the player's amazons (length 4 for 10x10 board)
+ *     a packed_move_t - the nth move
  */
-std::list<Point> Board::get_amazons(player_t player) {
-    std::list<Point> amazons;
+packed_move_t Board::nth_move(player_t player, int n, const int16_t *amazon_moves) {
+    Bitboard amazons = amazons_of(player);
 
-    for(int i=TOP_LEFT; i<=BOTTOM_RIGHT; i++) {
-        if(has_amazon(player, i)) {
-            amazons.push_back(Point(i));
-        }
-    }
-    return amazons;
-}
+    for(int i=0; amazons.any(); i++) {
+        int amazon = amazons.pop_lowest();
 
-/*
- * constructs a vector of all possible moves for a player on this board
- *
- * Params: 
- *     player - the player for whom we're compiling moves
- * Returns:
- *     a vector of move_t objects - every single move the player can make
- */
-std::vector<move_t> Board::get_moves(player_t player) {
-    std::vector<move_t> moves;
-    std::list<Point> amazons = get_amazons(player);
-    std::list<Point> new_loc_options;
-    std::list<Point> arrow_options;
-
-    for(Point amazon : amazons) {
-        new_loc_options = queen_reachables(amazon);
-        occupied.flip(amazon.to_bbval());
-        for(Point new_loc : new_loc_options) {
-            arrow_options = queen_reachables(new_loc);
-            for(Point arrow : arrow_options) {
-                moves.push_back({amazon, new_loc, arrow});
-            }
-        }
-        occupied.flip(amazon.to_bbval());
+        if(n < amazon_moves[i])
+            return nth_amazon_move(amazon, n);
+        n -= amazon_moves[i];
     }
-    return moves;
+
+    assert(false); // n was out of range
+    return NO_MOVE;
 }
 
 /*
- * OLD AI METHOD
- * determines the best next move for a player in the current position,
- * using the basic heuristic
+ * Picks a legal move for a player uniformly at random, without
+ * constructing the move list
  *
  * Params:
- *     player - the player for whom we want to find the best move
+ *     player - the player for whom we want a move
  * Return:
- *     a move_t - the ai's best guess at the optimal move for player
+ *     a packed_move_t - a random legal move, or NO_MOVE if there is none
  */
-move_t Board::best_move(player_t player) {
-    std::vector<move_t> moves = this->get_moves(player);
-    int best_eval = worst_eval(player);
-    move_t best_move;
-
-    for(move_t move : moves) {
-        int eval = this->evaluate(player, move);
-        if(first_better(player, eval, best_eval)) {
-            best_eval = eval;
-            best_move = move;
-        }
+packed_move_t Board::random_move(player_t player) {
+    Bitboard amazons = amazons_of(player);
+    int16_t counts[AMAZONS_PER_PLAYER];
+    int num_amazons = 0;
+    int total = 0;
+
+    while(amazons.any()) {
+        counts[num_amazons] = count_amazon_moves(amazons.pop_lowest());
+        total += counts[num_amazons++];
     }
-    return best_move;
-}
\ No newline at end of file
+    if(total == 0)
+        return NO_MOVE;
+    return nth_move(player, fast_rand() % total, counts);
+}
+
+} // namespace BOARD_NAMESPACE
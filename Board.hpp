@@ -1,27 +1,34 @@
 #ifndef BOARD_H
 #define BOARD_H
 
-#include <bitset>
-#include <list>
-#include <vector>
 #include "amazons.hpp"
+#include "Bitboard.hpp"
+
+namespace BOARD_NAMESPACE {
 
 #define has_amazon(p, v) (p ? left_amazons[v] : right_amazons[v])
 #define flip_amazon(p, v) (p ? left_amazons.flip(v) : right_amazons.flip(v))
+#define amazons_of(p) (p ? left_amazons : right_amazons)
 
-#define ALPHA 100 // empirically chosen parameter
 #define BIGNUM 999999 //greater than any possible evaluation value
 #define worst_eval(p) (p ? -BIGNUM : BIGNUM)
 #define first_better(p, a, b) (p ? a > b : a < b)
 
+#define ZOBRIST_SEED 0x2545F4914F6CDD1DULL // seeds the random keys of each piece on each square
+#define ZOBRIST_LEFT_TO_MOVE 0xD6E8FEB86659FD93ULL // xored into position_key() when left is to move
+
 /*
  * the board, internally represented as 3 bitboards - one for occupied squares, 
  * and one for each player's set of amazons
+ * Also keeps a Zobrist hash of the position, updated move by move
  */
 class Board {
-    std::bitset<SETSIZE> occupied;
-    std::bitset<SETSIZE> left_amazons;
-    std::bitset<SETSIZE> right_amazons;
+    Bitboard occupied;
+    Bitboard left_amazons;
+    Bitboard right_amazons;
+    uint64_t hash; // the xor of the Zobrist keys of every amazon and arrow
+
+    friend class EvalState;
 
     public:
     //////////////////  CONSTRUCTORS  /////////////////////
@@ -55,7 +62,8 @@ class Board {
      * Returns:
      *     a bool - true if the move is legal, false otherwise
      */
-    bool move_is_legal(player_t player, move_t move);
+    bool move_is_legal(player_t player, packed_move_t move);
+    bool move_is_legal(player_t player, move_t move) {return move_is_legal(player, pack_move(move));}
 
     /*
      * if the move is legal, mutates the board accordingly and returns true
@@ -69,31 +77,46 @@ class Board {
      * Returns:
      *     a bool - true if the move is legal, false otherwise
      */
-    bool make_move(player_t player, move_t move);
+    bool make_move(player_t player, packed_move_t move);
+    bool make_move(player_t player, move_t move) {return make_move(player, pack_move(move));}
 
     /*
-     * Returns the board resulting from making a certain move on this board,
-     * without altering this board.
+     * Makes a move without checking that it is legal. For the AI, whose moves
+     * all come from the move generators
      *
-     * Precondition: the move passed is a legal one
+     * Precondition: the move is legal
      *
      * Params:
-     *     player - which player is trying to make the move (left or right)
-     *     move - the move the player is trying to make
-     * Returns:
-     *     a Board object representing the board after the move is played
+     *     player - which player is making the move (left or right)
+     *     move - the move to make
+     * Returns: none
+     */
+    void do_move(player_t player, packed_move_t move);
+
+    /*
+     * Takes back the last move made with do_move() or make_move()
+     *
+     * Precondition: move is the last move made on this board, by player
+     *
+     * Params:
+     *     player - which player made the move (left or right)
+     *     move - the move to take back
+     * Returns: none
      */
-    Board make_move_immutably(player_t player, move_t move);
+    void undo_move(player_t player, packed_move_t move);
 
     /*
-     * Determines if the passed player has any legal moves
+     * Determines if the passed player has any legal moves. An amazon with an
+     * empty square next to her can always move there and shoot back at the
+     * square she left, so this is one mask of the squares around the amazons,
+     * and much cheaper than find_num_moves()
      *
      * Params:
      *     player - which player we're checking for moves
      * Return:
      *     a bool - true if the player is out of moves, false if they can still move
      */
-    bool no_moves(player_t player);
+    bool no_moves(player_t player) const;
 
     //////////////////  UI RELATED METHODS  ////////////////////
 
@@ -119,12 +142,25 @@ class Board {
 
     ////////////////////  AI RELATED METHODS  /////////////////////
 
+    /*
+     * The squares a chess queen could move to if it was on the square
+     * corresponding to index, as a bitboard
+     *
+     * Params:
+     *     index - the index in the bitboard of the queen's starting square
+     * Returns:
+     *     a Bitboard of every unoccupied square the queen could move to
+     */
+    Bitboard queen_attacks(int index) const {
+        return Bitboard::queen_attacks(Bitboard::square(index), ~occupied);
+    }
+
     /*
      * Helper for evaluate
      * Finds the number of squares a chess queen could move to if it was on the 
      * square corresponding to index
      *
-     * Note: could just call queen_reachables and take length, but doesn't for
+     * Note: could just call queen_attacks and take count, but doesn't for
      *       performance reasons. Needs to be fast so AI can consider as many
      *       moves as possible
      *
@@ -163,6 +199,20 @@ class Board {
      */
     int find_num_moves(player_t player);
 
+    /*
+     * The squares a player can reach by repeatedly moving their amazons like
+     * chess kings, including the squares the amazons stand on. Found with a
+     * word parallel flood fill
+     *
+     * Params:
+     *     player - the player whose region we want
+     * Return:
+     *     a Bitboard of the squares accessible to this player
+     */
+    Bitboard accessible_region(player_t player) const {
+        return Bitboard::king_flood_fill(amazons_of(player), ~occupied);
+    }
+
     /*
      * Helper for evaluate
      * Returns a count of the number of squares a player can reach by repeatedly
@@ -173,78 +223,100 @@ class Board {
      * Return:
      *     an int - the count of how many squares are accessible to this player
      */
-    int count_accessible_squares(player_t player);
+    int count_accessible_squares(player_t player) const {return accessible_region(player).count();}
+
+    // the number of squares with neither an amazon nor an arrow on them
+    int num_empty_squares() const {return (~occupied).count();}
+
+    // the squares with an amazon or an arrow on them, and the border
+    const Bitboard& get_occupied() const {return occupied;}
+
+    // the squares of the passed player's amazons
+    const Bitboard& get_amazons(player_t player) const {return amazons_of(player);}
+
+    // the Zobrist hash of the pieces on the board, kept up to date by make_move()
+    uint64_t get_hash() const {return hash;}
+
+    // a hash of the position with player to move, for tables keyed by position
+    uint64_t position_key(player_t player) const {return hash ^ (player ? ZOBRIST_LEFT_TO_MOVE : 0);}
 
     /*
-     * A heuristic which estimates which player the position is more favorable for
-     * Positive values are better for left; negative are better for right
-     * 
+     * Hashes the pieces on the board from scratch. make_move() keeps
+     * get_hash() equal to this without redoing it
+     *
      * Params: none
-     * Return:
-     *     an int - the more positive, the better for left
-     *              the more negative, the better for right
+     * Return: a uint64_t - the xor of the Zobrist keys of every amazon and arrow
      */
-    int evaluate();
-
-    // same as evaluate(), but prints additional info to stdout
-    int evaluate_verbose();
+    uint64_t compute_hash() const;
 
     /*
-     * Evaluates the position that would result from the playing of a passed move
+     * fills a caller supplied list with all possible moves for a player on this
+     * board. Does no heap allocation
      *
-     * Params:
-     *     player - the player who would make the move
-     *     move - the move after which we want to evaluate
-     * Return:
-     *     an int - the evaluation of the resulting position
+     * Params: 
+     *     player - the player for whom we're compiling moves
+     *     moves - the list to fill. Anything already in it is discarded
+     * Returns: none
      */
-    int evaluate(player_t player, move_t move);
-
-    // same as evaluate(), but prints additional info to stdout
-    int evaluate_verbose(player_t player, move_t move);
+    void get_moves(player_t player, MoveList& moves);
 
     /*
-     * Helper for get_moves()
-     * Constructs a list of points that a chess queen could move to starting from
-     * the passed square
+     * Finds the nth move that the amazon on the passed square can make, in
+     * the order get_moves() lists them. Skips whole destinations using their
+     * arrow counts, so it never builds the move list
+     *
+     * Precondition: 0 <= n < count_amazon_moves(index)
      *
      * Params:
-     *     start - the starting square
+     *     index - the index in the bitboard of the square the amazon starts at
+     *     n - the position of the move among this amazon's moves
      * Return:
-     *     a list of points - the points a queen at start could move to
+     *     a packed_move_t - the nth move of that amazon
      */
-    std::list<Point> queen_reachables(Point start);
+    packed_move_t nth_amazon_move(int index, int n);
 
     /*
-     * Helper for get_moves()
-     * constructs a list of the point locations of a player's amazons
+     * Finds the nth move in the list get_moves() would construct, without 
+     * constructing it. Skips whole amazons using count_amazon_moves()
+     *
+     * Precondition: 0 <= n < find_num_moves(player)
      *
      * Params:
-     *     player - the player whose amazons we want
+     *     player - the player whose moves we're indexing
+     *     n - the position of the move in the list
      * Return:
-     *     a list of points of length 4 - the player's 4 amazons
+     *     a packed_move_t - the nth move
      */
-    std::list<Point> get_amazons(player_t player);
+    packed_move_t nth_move(player_t player, int n);
 
     /*
-     * constructs a list of all possible moves for a player on this board
+     * Same as nth_move(), for a caller that already knows how many moves
+     * each of player's amazons has, so none are counted again
      *
-     * Params: 
-     *     player - the player for whom we're compiling moves
-     * Returns:
-     *     a list of move_t objects - every single move the player can make
+     * Precondition: 0 <= n < the sum of amazon_moves
+     *
+     * Params:
+     *     player - the player whose moves we're indexing
+     *     n - the position of the move in the list
+     *     amazon_moves - the move count of each of player's amazons, from
+     *                    the lowest square to the highest
+     * Return:
+     *     a packed_move_t - the nth move
      */
-    std::vector<move_t> get_moves(player_t player);
+    packed_move_t nth_move(player_t player, int n, const int16_t *amazon_moves);
 
     /*
-     * determines the best next move for a player in the current position
+     * Picks a legal move for a player uniformly at random, without
+     * constructing the move list
      *
      * Params:
-     *     player - the player for whom we want to find the best move
+     *     player - the player for whom we want a move
      * Return:
-     *     a move_t - the ai's best guess at the optimal move for player
+     *     a packed_move_t - a random legal move, or NO_MOVE if there is none
      */
-    move_t best_move(player_t player);
+    packed_move_t random_move(player_t player);
 };
 
+} // namespace BOARD_NAMESPACE
+
 #endif
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include <unordered_map>
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+#include "Endgame.hpp"
+
+namespace BOARD_NAMESPACE {
+
+// how many positions a solve may still visit, shared by every search it runs
+typedef struct search_budget {
+    long nodes_left;
+    bool aborted; // set once nodes_left runs out; results found after are only bounds
+} search_budget_t;
+
+// a position in a region with one player's amazons
+struct FillKey {
+    Bitboard squares;
+    Bitboard amazons;
+
+    bool operator==(const FillKey& other) const {
+        return this->squares == other.squares && this->amazons == other.amazons;
+    }
+};
+
+struct FillKeyHash {
+    size_t operator()(const FillKey& key) const {
+        return key.squares.hash() ^ (key.amazons.hash() * 31);
+    }
+};
+
+typedef struct fill_entry {
+    int moves; // the most moves found
+    bool exact; // whether moves was proved, or is only a lower bound
+    long max_nodes; // the node budget the count was searched with, if it isn't exact
+    packed_move_t first_move;
+} fill_entry_t;
+
+// a position with regions shared by both players, and the spare moves used from each player's own regions
+struct SolveKey {
+    Bitboard empty;
+    Bitboard amazons[2];
+    player_t player;
+    int spent[2];
+
+    bool operator==(const SolveKey& other) const {
+        return this->empty == other.empty && this->amazons[0] == other.amazons[0]
+               && this->amazons[1] == other.amazons[1] && this->player == other.player
+               && this->spent[0] == other.spent[0] && this->spent[1] == other.spent[1];
+    }
+};
+
+struct SolveKeyHash {
+    size_t operator()(const SolveKey& key) const {
+        return key.empty.hash() ^ (key.amazons[0].hash() * 31) ^ (key.amazons[1].hash() * 37)
+               ^ (key.player * 41) ^ ((size_t)key.spent[0] << 20) ^ ((size_t)key.spent[1] << 40);
+    }
+};
+
+// every searching thread solves endgames, so each keeps its own caches
+static thread_local std::unordered_map<FillKey, fill_entry_t, FillKeyHash> fill_cache;
+static thread_local std::unordered_map<SolveKey, bool, SolveKeyHash> solve_cache; // whether the player to move wins
+
+/*
+ * Splits the empty squares into regions
+ *
+ * Params:
+ *     empty - the unoccupied squares
+ *     amazons - each player's amazons, indexed by player_t
+ *     regions - filled with the regions
+ * Return: an int - the number of regions found
+ */
+static int find_regions(const Bitboard& empty, const Bitboard amazons[2], region_t *regions) {
+    Bitboard all_amazons = amazons[LEFT] | amazons[RIGHT];
+    Bitboard unassigned = Bitboard::king_dilation(empty) & all_amazons; // the amazons that can move
+    int num_regions = 0;
+
+    while(unassigned.any()) {
+        // an amazon next to two groups of squares can move into either, so
+        // the groups are one region. So is an amazon next to a member, which
+        // could move through the member's square once it leaves. Grow until
+        // no new amazon joins
+        Bitboard members = Bitboard::square(unassigned.lowest());
+        Bitboard squares;
+        while(true) {
+            squares = Bitboard::king_flood_fill(Bitboard::king_dilation(members) & empty, empty);
+            Bitboard touching = Bitboard::king_dilation(squares | members) & all_amazons;
+            if(touching == members)
+                break;
+            members = touching;
+        }
+
+        regions[num_regions].squares = squares;
+        regions[num_regions].amazons[LEFT] = members & amazons[LEFT];
+        regions[num_regions].amazons[RIGHT] = members & amazons[RIGHT];
+        num_regions++;
+        unassigned &= ~members;
+    }
+    return num_regions;
+}
+
+/*
+ * Splits the empty squares into regions. Squares no amazon can reach are
+ * left out, since no one can ever move there
+ *
+ * Params:
+ *     board - the position
+ *     regions - filled with the regions, up to MAX_REGIONS of them
+ * Return: an int - the number of regions found
+ */
+int find_regions(const Board& board, region_t *regions) {
+    Bitboard amazons[2];
+    amazons[LEFT] = board.get_amazons(LEFT);
+    amazons[RIGHT] = board.get_amazons(RIGHT);
+    return find_regions(~board.get_occupied(), amazons, regions);
+}
+
+/*
+ * Finds the most moves the amazons can make in squares, depth first. Every
+ * move fills one square, so the search stops as soon as a filling of every
+ * square the amazons can still reach is found
+ *
+ * Params:
+ *     region_squares - the empty squares of the region
+ *     amazons - the amazons in the region, all belonging to one player
+ *     budget - the positions the search may still visit
+ *     first_move - if not NULL, set to the first move of the longest filling found
+ * Return: an int - the most moves found, exact unless budget was aborted
+ */
+static int longest_filling(const Bitboard& region_squares, const Bitboard& amazons, search_budget_t *budget,
+                           packed_move_t *first_move) {
+    // squares walled off from every amazon will never be filled
+    Bitboard squares = Bitboard::king_flood_fill(Bitboard::king_dilation(amazons) & region_squares, region_squares);
+    FillKey key = {squares, amazons};
+    auto found = fill_cache.find(key);
+    if(found != fill_cache.end() && found->second.exact) {
+        if(first_move != NULL)
+            *first_move = found->second.first_move;
+        return found->second.moves;
+    }
+
+    int bound = squares.count();
+    int best = 0;
+    packed_move_t best_move = NO_MOVE;
+    Bitboard from = amazons;
+
+    while(from.any() && best < bound && !budget->aborted) {
+        int old_loc = from.pop_lowest();
+        Bitboard vacated = squares | Bitboard::square(old_loc);
+        Bitboard dests = Bitboard::queen_attacks(Bitboard::square(old_loc), squares);
+
+        while(dests.any() && best < bound && !budget->aborted) {
+            int new_loc = dests.pop_lowest();
+            Bitboard after_move = vacated;
+            after_move.reset(new_loc);
+            Bitboard moved = amazons ^ Bitboard::square(old_loc) ^ Bitboard::square(new_loc);
+            Bitboard arrows = Bitboard::queen_attacks(Bitboard::square(new_loc), after_move);
+
+            while(arrows.any() && best < bound) {
+                if(--budget->nodes_left < 0) {
+                    budget->aborted = true;
+                    break;
+                }
+                int arrow = arrows.pop_lowest();
+                Bitboard after = after_move;
+                after.reset(arrow);
+
+                int moves = 1 + longest_filling(after, moved, budget, NULL);
+                if(moves > best) {
+                    best = moves;
+                    best_move = pack_move(old_loc, new_loc, arrow);
+                }
+                if(budget->aborted)
+                    break;
+            }
+        }
+    }
+
+    if(!budget->aborted)
+        fill_cache[key] = {best, true, 0, best_move};
+    if(first_move != NULL)
+        *first_move = best_move;
+    return best;
+}
+
+/*
+ * Counts a single player region's moves with the nodes left in budget,
+ * reusing an earlier count searched with at least as many nodes
+ *
+ * Params:
+ *     region - the region, holding amazons of player only
+ *     player - the player whose moves to count
+ *     budget - the positions the search may still visit. Its abort is
+ *              cleared afterwards, so other regions still get searched
+ *     exact - set to whether the count was proved
+ *     first_move - set to the first move of a longest filling, or NO_MOVE
+ * Return: an int - the most moves found
+ */
+static int region_moves(const region_t& region, player_t player, search_budget_t *budget, bool *exact,
+                        packed_move_t *first_move) {
+    FillKey key = {region.squares, region.amazons[player]};
+    auto found = fill_cache.find(key);
+    if(found != fill_cache.end() && (found->second.exact || found->second.max_nodes >= budget->nodes_left)) {
+        *exact = found->second.exact;
+        *first_move = found->second.first_move;
+        return found->second.moves;
+    }
+
+    long max_nodes = budget->nodes_left;
+    int moves = longest_filling(region.squares, region.amazons[player], budget, first_move);
+    *exact = !budget->aborted;
+    if(budget->aborted) {
+        fill_cache[key] = {moves, false, max_nodes, *first_move};
+        budget->aborted = false;
+        budget->nodes_left = 0;
+    }
+    return moves;
+}
+
+/*
+ * Most moves a player can make in a region the other player has no amazons
+ * in. See Endgame.hpp
+ */
+int count_region_moves(const region_t& region, player_t player, long max_nodes, bool *exact,
+                       packed_move_t *first_move) {
+    search_budget_t budget = {max_nodes, false};
+    packed_move_t move;
+
+    if(fill_cache.size() > ENDGAME_CACHE_ENTRIES)
+        fill_cache.clear();
+    int moves = region_moves(region, player, &budget, exact, &move);
+    if(first_move != NULL)
+        *first_move = move;
+    return moves;
+}
+
+/*
+ * Works out whether the player to move wins. The regions only one player
+ * can move in are counted, and the moves in them after the first are
+ * treated as a pile of spare moves, which is all they are worth. The shared
+ * regions are searched move by move, alongside the option of spending a
+ * spare move instead
+ *
+ * Params:
+ *     empty - the unoccupied squares
+ *     amazons - each player's amazons, indexed by player_t
+ *     player - the player to move
+ *     spent - the spare moves each player has already used up, indexed by player_t
+ *     budget - the positions the search may still visit
+ *     best_move - if not NULL, set to a winning move if player wins. If
+ *                 player loses and no region is shared, set to a move which
+ *                 fills their regions as well as possible. Else NO_MOVE
+ * Return: an int - 1 if player wins, 0 if they lose, -1 if it isn't known
+ */
+static int solve(const Bitboard& empty, const Bitboard amazons[2], player_t player, const int spent[2],
+                 search_budget_t *budget, packed_move_t *best_move) {
+    region_t regions[MAX_REGIONS];
+    int num_regions = find_regions(empty, amazons, regions);
+    Bitboard shared_amazons; // the amazons of player in shared regions
+    int shared_squares = 0;
+
+    if(best_move != NULL)
+        *best_move = NO_MOVE;
+
+    for(int i=0; i < num_regions; i++) {
+        if(regions[i].amazons[LEFT].any() && regions[i].amazons[RIGHT].any()) {
+            shared_squares += regions[i].squares.count();
+            shared_amazons |= regions[i].amazons[player];
+        }
+    }
+    if(shared_squares > ENDGAME_MIXED_SQUARES)
+        return -1;
+
+    // each player's spare moves, as bounds in case a region was too big to count exactly
+    int least[2] = {-spent[0], -spent[1]};
+    int most[2] = {-spent[0], -spent[1]};
+    packed_move_t fill_move = NO_MOVE; // the first move of a longest filling of one of player's regions
+    for(int i=0; i < num_regions; i++) {
+        if(regions[i].amazons[LEFT].any() && regions[i].amazons[RIGHT].any())
+            continue;
+        player_t owner = regions[i].amazons[LEFT].any();
+        bool exact;
+        packed_move_t first_move;
+        int moves = region_moves(regions[i], owner, budget, &exact, &first_move);
+
+        least[owner] += moves;
+        most[owner] += exact ? moves : regions[i].squares.count();
+        if(owner == player && moves > 0 && fill_move == NO_MOVE)
+            fill_move = first_move;
+    }
+
+    if(shared_squares == 0) {
+        // player moves first, so they need strictly more moves to outlast the other player
+        if(least[player] > most[!player] || most[player] <= least[!player]) {
+            if(best_move != NULL)
+                *best_move = fill_move;
+            return least[player] > most[!player];
+        }
+        return -1;
+    }
+    if(least[LEFT] != most[LEFT] || least[RIGHT] != most[RIGHT])
+        return -1;
+
+    SolveKey key = {empty, {amazons[0], amazons[1]}, player, {spent[0], spent[1]}};
+    auto found = solve_cache.find(key);
+    if(found != solve_cache.end() && (best_move == NULL || !found->second))
+        return found->second;
+    if(--budget->nodes_left < 0) {
+        budget->aborted = true;
+        return -1;
+    }
+
+    bool unknown = false;
+    packed_move_t winning_move = NO_MOVE;
+    Bitboard from = shared_amazons;
+
+    while(from.any() && winning_move == NO_MOVE) {
+        int old_loc = from.pop_lowest();
+        Bitboard vacated = empty | Bitboard::square(old_loc);
+        Bitboard dests = Bitboard::queen_attacks(Bitboard::square(old_loc), empty);
+
+        while(dests.any() && winning_move == NO_MOVE) {
+            int new_loc = dests.pop_lowest();
+            Bitboard after_move = vacated;
+            after_move.reset(new_loc);
+            Bitboard arrows = Bitboard::queen_attacks(Bitboard::square(new_loc), after_move);
+            Bitboard moved[2] = {amazons[0], amazons[1]};
+            moved[player] ^= Bitboard::square(old_loc) ^ Bitboard::square(new_loc);
+
+            while(arrows.any() && winning_move == NO_MOVE) {
+                int arrow = arrows.pop_lowest();
+                Bitboard after = after_move;
+                after.reset(arrow);
+
+                int reply = solve(after, moved, !player, spent, budget, NULL);
+                if(reply == 0)
+                    winning_move = pack_move(old_loc, new_loc, arrow);
+                else if(reply < 0)
+                    unknown = true;
+            }
+        }
+    }
+
+    // spending a spare move leaves the shared regions to the other player
+    if(winning_move == NO_MOVE && least[player] > 0) {
+        int spent_after[2] = {spent[0], spent[1]};
+        spent_after[player]++;
+        int reply = solve(empty, amazons, !player, spent_after, budget, NULL);
+        if(reply == 0)
+            winning_move = fill_move;
+        else if(reply < 0)
+            unknown = true;
+    }
+
+    if(winning_move == NO_MOVE && unknown)
+        return -1;
+    solve_cache[key] = (winning_move != NO_MOVE);
+    if(best_move != NULL)
+        *best_move = winning_move;
+    return winning_move != NO_MOVE;
+}
+
+/*
+ * Solves a position exactly if it is decided: if no region is shared, or
+ * the shared regions hold at most ENDGAME_MIXED_SQUARES empty squares
+ *
+ * Params:
+ *     board - the position
+ *     player - the player to move
+ *     max_nodes - the most positions to search, including region fillings
+ * Return: the verdict, and a move to play, if the search found them
+ */
+endgame_result_t solve_endgame(const Board& board, player_t player, long max_nodes) {
+    search_budget_t budget = {max_nodes, false};
+    Bitboard amazons[2];
+    int spent[2] = {0, 0};
+    endgame_result_t result = {endgame_unsolved, NO_MOVE};
+
+    if(fill_cache.size() > ENDGAME_CACHE_ENTRIES)
+        fill_cache.clear();
+    if(solve_cache.size() > ENDGAME_CACHE_ENTRIES)
+        solve_cache.clear();
+
+    amazons[LEFT] = board.get_amazons(LEFT);
+    amazons[RIGHT] = board.get_amazons(RIGHT);
+    int outcome = solve(~board.get_occupied(), amazons, player, spent, &budget, &result.move);
+
+    if(outcome >= 0) {
+        player_t winner = (outcome == 1) ? player : !player;
+        result.verdict = (winner == LEFT) ? endgame_left_wins : endgame_right_wins;
+    }
+    return result;
+}
+
+} // namespace BOARD_NAMESPACE
@@ -0,0 +1,89 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+// An exact solver for the end of the game, once arrows have split the board
+// into separate regions. A region holding amazons of only one player is
+// worth exactly as many moves as that player can fill it with, and is
+// counted on its own. Regions still shared by both players are searched
+// exhaustively when they are small, with the players' own regions reduced
+// to a count of spare moves
+
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define MAX_REGIONS (2 * AMAZONS_PER_PLAYER) // every region worth counting holds an amazon
+#define ENDGAME_MIXED_SQUARES 12 // the most empty squares the shared regions may hold to be searched
+#define ENDGAME_CACHE_ENTRIES (1 << 16) // the size at which a thread's solver caches are emptied
+#define ENDGAME_ROOT_NODES 100000 // solver nodes spent on the position the AI has to move in
+#define ENDGAME_LEAF_NODES 100 // solver nodes spent on each leaf of the search tree
+
+/*
+ * A connected group of empty squares, with the amazons next to it and the
+ * amazons next to those. Amazons can never move or shoot from one region
+ * into another, so the regions are separate games played side by side
+ */
+typedef struct region {
+    Bitboard squares; // the empty squares
+    Bitboard amazons[2]; // the amazons of each player that can move into squares, indexed by player_t
+} region_t;
+
+// the outcome the solver proved, if any
+typedef enum {endgame_unsolved, endgame_left_wins, endgame_right_wins} endgame_verdict_t;
+
+// the evaluation of a solved position: the worst possible for the loser
+#define verdict_eval(v) ((v) == endgame_left_wins ? worst_eval(RIGHT) : worst_eval(LEFT))
+
+typedef struct endgame_result {
+    endgame_verdict_t verdict;
+    // a move that keeps the verdict for the player to move: a winning move
+    // if they win. If they lose and no region is shared, a move that fills
+    // their own regions as well as possible. Otherwise NO_MOVE
+    packed_move_t move;
+} endgame_result_t;
+
+/*
+ * Splits the empty squares into regions. Squares no amazon can reach are
+ * left out, since no one can ever move there
+ *
+ * Params:
+ *     board - the position
+ *     regions - filled with the regions, up to MAX_REGIONS of them
+ * Return: an int - the number of regions found
+ */
+int find_regions(const Board& board, region_t *regions);
+
+/*
+ * Finds the most moves a player can make in a region the other player has
+ * no amazons in. Searched depth first, with the results for positions seen
+ * before cached per thread. If the search runs out of nodes, the most moves
+ * found so far is a lower bound
+ *
+ * Params:
+ *     region - the region, holding amazons of player only
+ *     player - the player whose moves to count
+ *     max_nodes - the most positions to search
+ *     exact - set to whether the count was proved, or is only a lower bound
+ *     first_move - if not NULL, set to the first move of a longest filling, or NO_MOVE
+ * Return: an int - the most moves player can make in region
+ */
+int count_region_moves(const region_t& region, player_t player, long max_nodes, bool *exact,
+                       packed_move_t *first_move);
+
+/*
+ * Solves a position exactly if it is decided: if no region is shared, or
+ * the shared regions hold at most ENDGAME_MIXED_SQUARES empty squares
+ *
+ * Params:
+ *     board - the position
+ *     player - the player to move
+ *     max_nodes - the most positions to search, including region fillings
+ * Return: the verdict, and a move to play, if the search found them
+ */
+endgame_result_t solve_endgame(const Board& board, player_t player, long max_nodes);
+
+} // namespace BOARD_NAMESPACE
+
+#endif
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include "EvalCache.hpp"
+
+#define CACHE_LINE 64
+
+/*
+ * Allocates an empty cache
+ *
+ * Params:
+ *     bytes - the most memory the cache may take. Rounded down to a
+ *             power of two number of buckets
+ */
+EvalCache::EvalCache(size_t bytes) {
+    size_t bucket_bytes = EVAL_CACHE_BUCKET_SIZE * sizeof(entry_t);
+    void *memory = NULL;
+
+    this->num_buckets = 1;
+    while(this->num_buckets * 2 * bucket_bytes <= bytes)
+        this->num_buckets *= 2;
+
+    if(posix_memalign(&memory, CACHE_LINE, this->num_buckets * bucket_bytes) != 0)
+        throw std::bad_alloc();
+    this->entries = static_cast<entry_t *>(memory);
+    for(size_t i=0; i < this->num_buckets * EVAL_CACHE_BUCKET_SIZE; i++) {
+        new(&this->entries[i].check) std::atomic<uint64_t>(0);
+        new(&this->entries[i].data) std::atomic<uint64_t>(0);
+    }
+
+    this->hits = 0;
+    this->misses = 0;
+}
+
+EvalCache::~EvalCache() {
+    free(this->entries); // the atomics have trivial destructors
+}
+
+/*
+ * Looks up the score of a position
+ *
+ * Params:
+ *     key - the position, from Board::position_key()
+ *     eval - set to the position's score, if found
+ *     num_moves - set to the number of moves the player to move had, if found,
+ *                 or EVAL_CACHE_UNCOUNTED if they weren't counted
+ * Return: a bool - true if the position was found
+ */
+bool EvalCache::probe(uint64_t key, int *eval, int *num_moves) {
+    entry_t *entries = this->bucket(key);
+
+    for(int i=0; i < EVAL_CACHE_BUCKET_SIZE; i++) {
+        uint64_t data = entries[i].data.load(std::memory_order_relaxed);
+        uint64_t check = entries[i].check.load(std::memory_order_relaxed);
+
+        if(data != 0 && (check ^ data) == key) {
+            *eval = (int32_t)(uint32_t)data;
+            *num_moves = (data >> 32) & 0xFFFF;
+            this->hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    this->misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+/*
+ * Stores the score of a position, over an unused entry of its bucket if
+ * there is one, and over one picked by the key otherwise
+ *
+ * Params:
+ *     key - the position, from Board::position_key()
+ *     eval - the position's score
+ *     num_moves - the number of moves the player to move has, or
+ *                 EVAL_CACHE_UNCOUNTED if they weren't counted
+ * Return: none
+ */
+void EvalCache::store(uint64_t key, int eval, int num_moves) {
+    entry_t *entries = this->bucket(key);
+    entry_t *slot = &entries[(key >> 32) % EVAL_CACHE_BUCKET_SIZE];
+    uint64_t data = pack(eval, num_moves);
+
+    for(int i=0; i < EVAL_CACHE_BUCKET_SIZE; i++) {
+        if(entries[i].data.load(std::memory_order_relaxed) == 0) {
+            slot = &entries[i];
+            break;
+        }
+    }
+    slot->check.store(key ^ data, std::memory_order_relaxed);
+    slot->data.store(data, std::memory_order_relaxed);
+}
+
+// empties the cache and zeroes the counters
+void EvalCache::clear() {
+    for(size_t i=0; i < this->num_buckets * EVAL_CACHE_BUCKET_SIZE; i++) {
+        this->entries[i].check.store(0, std::memory_order_relaxed);
+        this->entries[i].data.store(0, std::memory_order_relaxed);
+    }
+    this->hits = 0;
+    this->misses = 0;
+}
+
+// a snapshot of the counters
+eval_cache_stats_t EvalCache::get_stats() const {
+    return {this->hits.load(), this->misses.load()};
+}
+
+// prints the counters to stdout
+void EvalCache::print_stats() const {
+    eval_cache_stats_t stats = this->get_stats();
+    long lookups = stats.hits + stats.misses;
+    double hit_rate = (lookups > 0) ? 100.0 * stats.hits / lookups : 0;
+
+    printf("evaluation cache: %ld lookups, %.1f%% hits\n", lookups, hit_rate);
+}
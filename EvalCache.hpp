@@ -0,0 +1,103 @@
+#ifndef EVALCACHE_H
+#define EVALCACHE_H
+
+// A fixed size table of leaf scores keyed by position, so that a rollout
+// ending on a position scored before costs one lookup instead of the
+// heuristic's full set of ray walks and searches. Each entry is two 64 bit
+// words: the data, and the key XORed with the data. A reader checks the
+// pair against the key it wants, so an entry torn by two threads writing
+// at once reads as a miss and the table needs no locks
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+
+#define EVAL_CACHE_BUCKET_SIZE 4 // entries per bucket, which fill one 64 byte cache line
+#define EVAL_CACHE_UNCOUNTED 0xFFFF // the move count of an entry stored without one
+
+// how well the cache is serving the search
+typedef struct eval_cache_stats {
+    long hits; // scores found in the cache
+    long misses; // scores that had to be computed
+} eval_cache_stats_t;
+
+class EvalCache {
+    typedef struct entry {
+        std::atomic<uint64_t> check; // key ^ data
+        std::atomic<uint64_t> data; // a packed score and move count, or 0 if unused
+    } entry_t;
+
+    entry_t *entries; // num_buckets buckets of EVAL_CACHE_BUCKET_SIZE entries, cache line aligned
+    size_t num_buckets; // a power of two
+
+    // kept off the cache line of the fields above, which every lookup reads,
+    // since every lookup also updates one of these
+    char padding[64];
+    std::atomic<long> hits;
+    std::atomic<long> misses;
+
+    // the bucket a position's entry can be in
+    entry_t *bucket(uint64_t key) const {
+        return this->entries + (key & (this->num_buckets - 1)) * EVAL_CACHE_BUCKET_SIZE;
+    }
+
+    // the data word is the score in the low 32 bits, the move count in the
+    // next 16, and a bit that marks the entry used
+    static uint64_t pack(int eval, int num_moves) {
+        return (uint32_t)eval | ((uint64_t)(num_moves & 0xFFFF) << 32) | (1ULL << 48);
+    }
+
+    public:
+    /*
+     * Allocates an empty cache
+     *
+     * Params:
+     *     bytes - the most memory the cache may take. Rounded down to a
+     *             power of two number of buckets
+     */
+    explicit EvalCache(size_t bytes);
+
+    ~EvalCache();
+
+    EvalCache(const EvalCache&) = delete;
+    EvalCache& operator=(const EvalCache&) = delete;
+
+    // the memory the cache takes, in bytes
+    size_t bytes() const {return this->num_buckets * EVAL_CACHE_BUCKET_SIZE * sizeof(entry_t);}
+
+    /*
+     * Looks up the score of a position
+     *
+     * Params:
+     *     key - the position, from Board::position_key()
+     *     eval - set to the position's score, if found
+     *     num_moves - set to the number of moves the player to move had, if found,
+     *                 or EVAL_CACHE_UNCOUNTED if they weren't counted
+     * Return: a bool - true if the position was found
+     */
+    bool probe(uint64_t key, int *eval, int *num_moves);
+
+    /*
+     * Stores the score of a position, over an unused entry of its bucket if
+     * there is one, and over one picked by the key otherwise
+     *
+     * Params:
+     *     key - the position, from Board::position_key()
+     *     eval - the position's score
+     *     num_moves - the number of moves the player to move has, or
+     *                 EVAL_CACHE_UNCOUNTED if they weren't counted
+     * Return: none
+     */
+    void store(uint64_t key, int eval, int num_moves);
+
+    // empties the cache and zeroes the counters
+    void clear();
+
+    // a snapshot of the counters
+    eval_cache_stats_t get_stats() const;
+
+    // prints the counters to stdout
+    void print_stats() const;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+#include "EvalState.hpp"
+
+namespace BOARD_NAMESPACE {
+
+/*
+ * Counts every amazon's moves from scratch
+ *
+ * Params:
+ *     board - the board to describe
+ */
+EvalState::EvalState(Board& board) {
+    player_t players[2] = {LEFT, RIGHT};
+
+    for(player_t player : players) {
+        int slot = player_slot(player);
+        Bitboard amazons = player ? board.left_amazons : board.right_amazons;
+
+        this->num_moves[slot] = 0;
+        for(int i=0; i < AMAZONS_PER_PLAYER; i++) {
+            this->squares[slot][i] = amazons.pop_lowest();
+            this->amazon_moves[slot][i] = board.count_amazon_moves(this->squares[slot][i]);
+            this->stale[slot][i] = false;
+            this->num_moves[slot] += this->amazon_moves[slot][i];
+        }
+    }
+}
+
+/*
+ * Brings the state up to date after a move. An amazon's moves can only
+ * change if one of the squares the move changed is within two queen
+ * moves of it, along squares that were empty both before and after the
+ * move. Those of the next player's amazons are recounted, along with any
+ * left stale by the previous move; those of the mover are marked stale
+ *
+ * Params:
+ *     after - the board the state describes, once the move is made on it
+ *     player - the player who made the move
+ *     move - the move made
+ * Return: none
+ */
+void EvalState::update(Board& after, player_t player, packed_move_t move) {
+    int start = move_old_loc(move);
+    int finish = move_new_loc(move);
+    Bitboard changed = Bitboard::square(start) | Bitboard::square(finish) | Bitboard::square(move_arrow(move));
+    // only the squares of the move changed, and each of them is occupied either before or after it
+    Bitboard still_empty = ~after.occupied & ~changed;
+
+    // the squares an amazon's destinations are found among, and the squares
+    // her arrows are found among from each destination
+    Bitboard affected = Bitboard::queen_reach(Bitboard::queen_reach(changed, still_empty), still_empty);
+
+    // the moved amazon keeps her place in the sorted order by sliding past her neighbours
+    int mover = player_slot(player);
+    uint8_t *squares = this->squares[mover];
+    int16_t *amazon_moves = this->amazon_moves[mover];
+    bool *stale = this->stale[mover];
+    int i = 0;
+    while(squares[i] != start) i++;
+    int16_t moved_moves = amazon_moves[i];
+    for(; i > 0 && squares[i - 1] > finish; i--) {
+        squares[i] = squares[i - 1];
+        amazon_moves[i] = amazon_moves[i - 1];
+        stale[i] = stale[i - 1];
+    }
+    for(; i < AMAZONS_PER_PLAYER - 1 && squares[i + 1] < finish; i++) {
+        squares[i] = squares[i + 1];
+        amazon_moves[i] = amazon_moves[i + 1];
+        stale[i] = stale[i + 1];
+    }
+    squares[i] = finish;
+    amazon_moves[i] = moved_moves; // marked stale below, since finish changed
+
+    for(int j=0; j < AMAZONS_PER_PLAYER; j++) {
+        if(affected[squares[j]])
+            stale[j] = true;
+    }
+
+    int next = player_slot(!player);
+    for(int j=0; j < AMAZONS_PER_PLAYER; j++) {
+        if(this->stale[next][j] || affected[this->squares[next][j]]) {
+            int moves = after.count_amazon_moves(this->squares[next][j]);
+            this->num_moves[next] += moves - this->amazon_moves[next][j];
+            this->amazon_moves[next][j] = moves;
+            this->stale[next][j] = false;
+        }
+    }
+
+#ifdef EVAL_CROSSCHECK
+    this->cross_check(after, "update");
+#endif
+}
+
+/*
+ * The number of legal moves player has, for either player. Only the
+ * stale amazons are recounted on the board
+ *
+ * Params:
+ *     board - the board the state describes
+ *     player - the player whose moves to count
+ * Return:
+ *     an int - the same count as board.find_num_moves(player)
+ */
+int EvalState::exact_num_moves(Board& board, player_t player) const {
+    int slot = player_slot(player);
+    int moves = this->num_moves[slot];
+
+    for(int i=0; i < AMAZONS_PER_PLAYER; i++) {
+        if(this->stale[slot][i])
+            moves += board.count_amazon_moves(this->squares[slot][i]) - this->amazon_moves[slot][i];
+    }
+
+#ifdef EVAL_CROSSCHECK
+    this->cross_check(board, "exact_num_moves");
+    if(moves != board.find_num_moves(player)) {
+        fprintf(stderr, "EvalState exact_num_moves: got %i, a full count gives %i\n",
+                moves, board.find_num_moves(player));
+        abort();
+    }
+#endif
+    return moves;
+}
+
+/*
+ * Compares the state with a full recount on board, and aborts the
+ * program with a description of the difference if they disagree
+ *
+ * Params:
+ *     board - the board the state should describe
+ *     context - what was just done to the state, for the error message
+ * Return: none
+ */
+void EvalState::cross_check(Board& board, const char *context) const {
+    EvalState recounted(board);
+
+    for(int slot=0; slot < 2; slot++) {
+        int num_moves = 0;
+        for(int i=0; i < AMAZONS_PER_PLAYER; i++) {
+            num_moves += this->amazon_moves[slot][i];
+            if(this->squares[slot][i] != recounted.squares[slot][i]
+               || (!this->stale[slot][i] && this->amazon_moves[slot][i] != recounted.amazon_moves[slot][i])) {
+                fprintf(stderr, "EvalState %s: amazon %i of player %i is on %i with %i moves, "
+                                "a recount has her on %i with %i moves\n",
+                        context, i, slot, this->squares[slot][i], this->amazon_moves[slot][i],
+                        recounted.squares[slot][i], recounted.amazon_moves[slot][i]);
+                abort();
+            }
+        }
+        if(this->num_moves[slot] != num_moves) {
+            fprintf(stderr, "EvalState %s: player %i has %i moves, but their amazons have %i\n",
+                    context, slot, this->num_moves[slot], num_moves);
+            abort();
+        }
+    }
+}
+
+} // namespace BOARD_NAMESPACE
@@ -0,0 +1,83 @@
+#ifndef EVALSTATE_H
+#define EVALSTATE_H
+
+// The move counts of each amazon, carried alongside a Board and updated
+// move by move, so that only the amazons a move can affect are recounted.
+// Only the counts of the player to move are kept exact; the other player's
+// affected amazons are marked stale and recounted when that player is next
+// to move, or when the position is evaluated.
+// Compile with -DEVAL_CROSSCHECK to check every update against a full recount
+
+#include <stdint.h>
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define player_slot(p) (p ? 0 : 1) // row of the per player arrays holding p's amazons
+
+class EvalState {
+    // each player's amazons, sorted by square so they are in the same order
+    // as in Board::get_moves(), with the number of moves each can make
+    uint8_t squares[2][AMAZONS_PER_PLAYER];
+    int16_t amazon_moves[2][AMAZONS_PER_PLAYER];
+    bool stale[2][AMAZONS_PER_PLAYER]; // whether amazon_moves may be out of date
+    int num_moves[2]; // the sum of amazon_moves, stale counts included
+
+    /*
+     * Compares the state with a full recount on board, and aborts the
+     * program with a description of the difference if they disagree
+     *
+     * Params:
+     *     board - the board the state should describe
+     *     context - what was just done to the state, for the error message
+     * Return: none
+     */
+    void cross_check(Board& board, const char *context) const;
+
+    public:
+    EvalState() {}
+
+    /*
+     * Counts every amazon's moves from scratch
+     *
+     * Params:
+     *     board - the board to describe
+     */
+    explicit EvalState(Board& board);
+
+    /*
+     * Brings the state up to date after a move. An amazon's moves can only
+     * change if one of the squares the move changed is within two queen
+     * moves of it, along squares that were empty both before and after the
+     * move. Those of the next player's amazons are recounted, along with any
+     * left stale by the previous move; those of the mover are marked stale
+     *
+     * Params:
+     *     after - the board the state describes, once the move is made on it
+     *     player - the player who made the move
+     *     move - the move made
+     * Return: none
+     */
+    void update(Board& after, player_t player, packed_move_t move);
+
+    // the number of legal moves player has. Only exact for the player to move
+    int get_num_moves(player_t player) const {return this->num_moves[player_slot(player)];}
+
+    /*
+     * The number of legal moves player has, for either player. Only the
+     * stale amazons are recounted on the board
+     *
+     * Params:
+     *     board - the board the state describes
+     *     player - the player whose moves to count
+     * Return:
+     *     an int - the same count as board.find_num_moves(player)
+     */
+    int exact_num_moves(Board& board, player_t player) const;
+};
+
+} // namespace BOARD_NAMESPACE
+
+#endif
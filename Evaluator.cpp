@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <string.h>
+#include "amazons.hpp"
+#include "Board.hpp"
+#include "EvalState.hpp"
+#include "Evaluator.hpp"
+#include "Territory.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define CONFIG_LINE_LENGTH 256
+
+// prints the classic terms of the position to stdout, and returns its evaluation
+int ClassicEvaluator::print_terms(Board& board) const {
+    int left_moves = board.find_num_moves(LEFT);
+    int right_moves = board.find_num_moves(RIGHT);
+    int left_accesible = board.count_accessible_squares(LEFT);
+    int right_accessible = board.count_accessible_squares(RIGHT);
+    int eval = this->weights.moves * (left_moves - right_moves)
+             + this->weights.access * (left_accesible - right_accessible);
+
+    printf("left moves: %i\n", left_moves);
+    printf("right moves: %i\n", right_moves);
+    printf("left access: %i\n", left_accesible);
+    printf("right access: %i\n", right_accessible);
+    printf("Final eval: %i\n", eval);
+    return eval;
+}
+
+/*
+ * Evaluates a position with the evaluator config picks, printing the terms
+ * to stdout. For the UI; the search dispatches on config.type itself
+ *
+ * Params:
+ *     config - which evaluator to use, and its weights
+ *     board - the position
+ * Return: an int - the evaluation of the position
+ */
+int evaluate_verbose(const evaluator_config_t& config, Board& board) {
+    switch(config.type) {
+        case territory_evaluator:
+            return TerritoryEvaluator(config.territory).evaluate_verbose(board);
+        case classic_evaluator:
+        default:
+            return ClassicEvaluator(config.classic).evaluate_verbose(board);
+    }
+}
+
+// the territory weight a key names, or NULL if it names none
+static term_weight_t *territory_weight(territory_weights_t& weights, const char *key) {
+    if(strcmp(key, "queen_territory") == 0) return &weights.queen_territory;
+    if(strcmp(key, "king_territory") == 0) return &weights.king_territory;
+    if(strcmp(key, "queen_closeness") == 0) return &weights.queen_closeness;
+    if(strcmp(key, "king_closeness") == 0) return &weights.king_closeness;
+    if(strcmp(key, "mobility") == 0) return &weights.mobility;
+    return NULL;
+}
+
+/*
+ * Reads evaluator settings from a file, on top of the ones already in
+ * config. Each line is "key = value", and # starts a comment. The keys are
+ *     evaluator - classic or territory
+ *     moves, access - the classic weights
+ *     queen_territory, king_territory, queen_closeness, king_closeness,
+ *     mobility - the territory weights, as "opening endgame", or as one
+ *                number for both
+ * Prints the first problem found to stderr
+ *
+ * Params:
+ *     path - the file to read
+ *     config - the settings to update
+ * Return: a bool - true if the whole file was read, false if it couldn't be
+ *         opened or has a line that doesn't parse
+ */
+bool load_evaluator_config(const char *path, evaluator_config_t& config) {
+    FILE *file = fopen(path, "r");
+    char line[CONFIG_LINE_LENGTH];
+    char key[CONFIG_LINE_LENGTH];
+    char value[CONFIG_LINE_LENGTH];
+    int line_number = 0;
+    bool ok = true;
+
+    if(file == NULL) {
+        fprintf(stderr, "%s: could not open the file\n", path);
+        return false;
+    }
+
+    while(ok && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if(comment != NULL)
+            *comment = '\0';
+
+        char *equals = strchr(line, '=');
+        if(equals == NULL) {
+            ok = (sscanf(line, " %s", key) != 1); // only a blank line may lack an =
+        } else {
+            *equals = '\0';
+            if(sscanf(line, " %s", key) != 1 || sscanf(equals + 1, " %[^\n]", value) != 1) {
+                ok = false;
+            } else if(strcmp(key, "evaluator") == 0) {
+                char name[CONFIG_LINE_LENGTH];
+                ok = (sscanf(value, "%s", name) == 1);
+                if(ok && strcmp(name, "classic") == 0)
+                    config.type = classic_evaluator;
+                else if(ok && strcmp(name, "territory") == 0)
+                    config.type = territory_evaluator;
+                else
+                    ok = false;
+            } else if(strcmp(key, "moves") == 0) {
+                ok = (sscanf(value, "%d", &config.classic.moves) == 1);
+            } else if(strcmp(key, "access") == 0) {
+                ok = (sscanf(value, "%d", &config.classic.access) == 1);
+            } else {
+                term_weight_t *weight = territory_weight(config.territory, key);
+                int num_read = (weight == NULL) ? 0 : sscanf(value, "%lf %lf", &weight->opening, &weight->endgame);
+                if(num_read == 1)
+                    weight->endgame = weight->opening;
+                ok = (num_read >= 1);
+            }
+        }
+
+        if(!ok)
+            fprintf(stderr, "%s:%i: could not read the setting\n", path, line_number);
+    }
+
+    fclose(file);
+    return ok;
+}
+
+} // namespace BOARD_NAMESPACE
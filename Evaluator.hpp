@@ -0,0 +1,210 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+// The heuristics the AI can score positions with, as interchangeable
+// classes. Code that evaluates positions in a loop is a template over the
+// evaluator class, so the heuristic is picked with one switch per search
+// and its evaluation is inlined into the loop, with no virtual call
+
+#include "amazons.hpp"
+#include "BatchEval.hpp"
+#include "Board.hpp"
+#include "EvalState.hpp"
+#include "Territory.hpp"
+
+namespace BOARD_NAMESPACE {
+
+/*
+ * The parts every evaluator shares, built on the evaluate_position() and
+ * print_terms() of the Derived class (the curiously recurring template
+ * pattern). Derived must provide:
+ *     static const bool needs_state - whether evaluate_position() reads the
+ *         state. If not, it is passed an empty one, and the moves aren't counted
+ *     int evaluate_position(Board& board, const EvalState& state) const
+ *     int print_terms(Board& board) const
+ * and may provide its own evaluate_children(), if it can score the
+ * children of a position faster together than one at a time
+ */
+template<class Derived>
+class Evaluator {
+    const Derived& derived() const {return static_cast<const Derived&>(*this);}
+
+    public:
+    /*
+     * A heuristic which estimates which player the position is more favorable for
+     * Positive values are better for left; negative are better for right
+     *
+     * Params:
+     *     board - the position
+     *     state - the move counts of board
+     * Return:
+     *     an int - the more positive, the better for left
+     *              the more negative, the better for right
+     */
+    int evaluate(Board& board, const EvalState& state) const {
+        return this->derived().evaluate_position(board, state);
+    }
+
+    // same as evaluate(), for a board without a state to hand
+    int evaluate(Board& board) const {
+        if(!Derived::needs_state)
+            return this->evaluate(board, EvalState());
+        return this->evaluate(board, EvalState(board));
+    }
+
+    // same as evaluate(), but prints the terms to stdout
+    int evaluate_verbose(Board& board) const {
+        return this->derived().print_terms(board);
+    }
+
+    /*
+     * Evaluates the position after each of a list of moves, making and
+     * taking back each move on board in turn
+     *
+     * Params:
+     *     board - the position before the moves, left as it was
+     *     state - the move counts of board
+     *     player - the player making the moves
+     *     moves - the moves, each legal
+     *     num_moves - the length of moves
+     *     evals - filled with the evaluation of the position after each move
+     * Return: none
+     */
+    void evaluate_children(Board& board, const EvalState& state, player_t player, const packed_move_t *moves,
+                           int num_moves, int *evals) const {
+        for(int i=0; i < num_moves; i++) {
+            EvalState child_state = state;
+            board.do_move(player, moves[i]);
+            child_state.update(board, player, moves[i]);
+            evals[i] = this->evaluate(board, child_state);
+            board.undo_move(player, moves[i]);
+        }
+    }
+
+    /*
+     * Determines the best next move for a player by evaluating the position
+     * after each of their moves, one ply deep
+     *
+     * Params:
+     *     board - the position
+     *     player - the player for whom we want to find the best move
+     * Return:
+     *     a packed_move_t - the move leading to the best evaluation, or
+     *     NO_MOVE if player has no moves
+     */
+    packed_move_t best_move(Board& board, player_t player) const {
+        MoveList moves;
+        int evals[MAX_MOVES];
+        int best_eval = worst_eval(player);
+        packed_move_t best_move = NO_MOVE;
+
+        board.get_moves(player, moves);
+        this->derived().evaluate_children(board, EvalState(board), player, moves.begin(), moves.size(), evals);
+        for(int i=0; i < moves.size(); i++) {
+            if(best_move == NO_MOVE || first_better(player, evals[i], best_eval)) {
+                best_eval = evals[i];
+                best_move = moves[i];
+            }
+        }
+        return best_move;
+    }
+};
+
+/*
+ * The difference in legal moves plus a multiple of the difference in
+ * accessible squares. The move counts come from the EvalState, so only the
+ * accessible squares are counted from scratch
+ */
+class ClassicEvaluator : public Evaluator<ClassicEvaluator> {
+    classic_weights_t weights;
+
+    public:
+    static const bool needs_state = true;
+
+    explicit ClassicEvaluator(const classic_weights_t& weights) : weights(weights) {}
+
+    int evaluate_position(Board& board, const EvalState& state) const {
+        int num_moves_diff = state.exact_num_moves(board, LEFT) - state.exact_num_moves(board, RIGHT);
+        int accesible_squares_diff = board.count_accessible_squares(LEFT) - board.count_accessible_squares(RIGHT);
+
+        return this->weights.moves * num_moves_diff + this->weights.access * accesible_squares_diff;
+    }
+
+    /*
+     * Evaluator::evaluate_children(), with the terms of several children
+     * counted at once by classic_child_terms(). Gives the same evaluations
+     *
+     * Params:
+     *     board - the position before the moves
+     *     state - unused; every child is counted from scratch
+     *     player - the player making the moves
+     *     moves - the moves, each legal
+     *     num_moves - the length of moves
+     *     evals - filled with the evaluation of the position after each move
+     * Return: none
+     */
+    void evaluate_children(Board& board, const EvalState& state, player_t player, const packed_move_t *moves,
+                           int num_moves, int *evals) const {
+        int move_diffs[MAX_MOVES];
+        int access_diffs[MAX_MOVES];
+
+        classic_child_terms(board, player, moves, num_moves, move_diffs, access_diffs);
+        for(int i=0; i < num_moves; i++) {
+            evals[i] = this->weights.moves * move_diffs[i] + this->weights.access * access_diffs[i];
+        }
+    }
+
+    int print_terms(Board& board) const;
+};
+
+/*
+ * Who reaches each empty square first by queen and by king moves, and
+ * distance weighted mobility. See Territory.hpp
+ */
+class TerritoryEvaluator : public Evaluator<TerritoryEvaluator> {
+    territory_weights_t weights;
+
+    public:
+    static const bool needs_state = false;
+
+    explicit TerritoryEvaluator(const territory_weights_t& weights) : weights(weights) {}
+
+    int evaluate_position(Board& board, const EvalState& state) const {
+        return evaluate_territory(board, this->weights);
+    }
+
+    int print_terms(Board& board) const {return evaluate_territory_verbose(board, this->weights);}
+};
+
+/*
+ * Evaluates a position with the evaluator config picks, printing the terms
+ * to stdout. For the UI; the search dispatches on config.type itself
+ *
+ * Params:
+ *     config - which evaluator to use, and its weights
+ *     board - the position
+ * Return: an int - the evaluation of the position
+ */
+int evaluate_verbose(const evaluator_config_t& config, Board& board);
+
+/*
+ * Reads evaluator settings from a file, on top of the ones already in
+ * config. Each line is "key = value", and # starts a comment. The keys are
+ *     evaluator - classic or territory
+ *     moves, access - the classic weights
+ *     queen_territory, king_territory, queen_closeness, king_closeness,
+ *     mobility - the territory weights, as "opening endgame", or as one
+ *                number for both
+ * Prints the first problem found to stderr
+ *
+ * Params:
+ *     path - the file to read
+ *     config - the settings to update
+ * Return: a bool - true if the whole file was read, false if it couldn't be
+ *         opened or has a line that doesn't parse
+ */
+bool load_evaluator_config(const char *path, evaluator_config_t& config);
+
+} // namespace BOARD_NAMESPACE
+
+#endif
@@ -1,12 +1,126 @@
 #include <assert.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
-#include <unordered_set>
+#include <algorithm>
+#include <unordered_map>
 #include "amazons.hpp"
+#include "BatchEval.hpp"
 #include "Board.hpp"
+#include "Evaluator.hpp"
 #include "MoveTree.hpp"
+#include "Playout.hpp"
+
+namespace BOARD_NAMESPACE {
+
+/*
+ * Starts num_threads - 1 worker threads
+ *
+ * Params:
+ *     num_threads - the number of threads (including the caller's) that play out each batch
+ */
+LeafPool::LeafPool(int num_threads) {
+    this->evaluator = NULL;
+    this->play_out = NULL;
+    this->leaf = NULL;
+    this->board = NULL;
+    this->depth = 0;
+    this->num_playouts = 0;
+    this->next_playout = 0;
+    this->busy_workers = 0;
+    this->batch_number = 0;
+    this->stopping = false;
+    this->batch_evals.resize(num_threads);
+
+    for(int i=1; i < num_threads; i++) {
+        this->workers.push_back(std::thread(&LeafPool::work, this, (uint64_t)fast_rand()));
+    }
+}
+
+// stops and joins the workers
+LeafPool::~LeafPool() {
+    {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->stopping = true;
+    }
+    this->work_ready.notify_all();
+    for(std::thread& worker : this->workers) {
+        worker.join();
+    }
+}
+
+// plays playouts from the current batch until none are left to claim
+void LeafPool::play_batch() {
+    int i;
+    while((i = this->next_playout.fetch_add(1)) < this->num_playouts) {
+        this->evals[i] = this->play_out(this->leaf, *this->board, this->depth, this->evaluator);
+    }
+}
+
+/*
+ * The loop run by each worker thread
+ *
+ * Params:
+ *     seed - the seed for the worker's random number generator
+ * Return: none
+ */
+void LeafPool::work(uint64_t seed) {
+    int batches_seen = 0;
+
+    seed_fast_rand(seed); // so that the workers' playouts differ
+    while(true) {
+        {
+            std::unique_lock<std::mutex> guard(this->mutex);
+            this->work_ready.wait(guard, [&] {return this->stopping || this->batch_number != batches_seen;});
+            if(this->stopping)
+                return;
+            batches_seen = this->batch_number;
+        }
+
+        this->play_batch();
+
+        std::lock_guard<std::mutex> guard(this->mutex);
+        if(--this->busy_workers == 0)
+            this->work_done.notify_one();
+    }
+}
+
+// the body of evaluate(), once the evaluator is set
+void LeafPool::evaluate_batch(MoveTree *leaf, const Board& board, int depth, int *evals, int num_playouts) {
+    {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->leaf = leaf;
+        this->board = &board;
+        this->depth = depth;
+        this->evals = evals;
+        this->num_playouts = num_playouts;
+        this->next_playout = 0;
+        this->busy_workers = this->workers.size();
+        this->batch_number++;
+    }
+    this->work_ready.notify_all();
+
+    this->play_batch();
+
+    std::unique_lock<std::mutex> guard(this->mutex);
+    this->work_done.wait(guard, [&] {return this->busy_workers == 0;});
+}
+
+// greatest common divisor, for picking expansion strides
+static int gcd(int a, int b) {
+    while(b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
 
 /*
  * This is the constructor used from outside the class to construct an empty tree
@@ -14,20 +128,38 @@
  * Params:
  *     board - the board state of the tree
  *     player - whose turn it is to move
+ *     arena - the arena to allocate nodes from. If NULL, the tree creates
+ *             (and later frees) its own
  */
-MoveTree::MoveTree(Board board, player_t player) {
+MoveTree::MoveTree(Board board, player_t player, NodeArena<MoveTree> *arena) {
     this->parent = this;
-    // there is no previous move
+    this->prev_move = NO_MOVE; // there is no previous move
 
-    this->board = Board(board);
+    this->position = new Board(board);
     this->player = player;
+    this->split_moves = false;
+    this->arrow_pending = false;
+    this->has_moves = !this->position->no_moves(player);
+    this->key = this->position->position_key(player);
+
+    this->owns_arena = (arena == NULL);
+    this->arena = this->owns_arena ? new NodeArena<MoveTree>() : arena;
+    this->transpositions = NULL;
+    this->owns_transpositions = false;
+    this->shared_stats = NULL;
+    this->eval_cache = NULL;
+    this->owns_eval_cache = false;
 
-    this->num_moves = this->board.find_num_moves(this->player);
-    this->children = std::vector<MoveTree*>();
-    this->child_indices = std::unordered_set<int>();
+    this->first_child = NULL;
+    this->next_sibling = NULL;
+    this->num_children = 0;
+    this->count_moves(*this->position); // the root is always expanded
+    this->expansion_lock.clear();
 
     this->num_wins = 0;
     this->num_rollouts = 0;
+    this->prior = 1;
+    this->endgame = ENDGAME_UNCHECKED;
 }
 
 /*
@@ -36,152 +168,718 @@ MoveTree::MoveTree(Board board, player_t player) {
  * Params:
  *     parent - a pointer to the parent node
  *     move - the move which transposes the parent's board to this one's
- *     index - the index of this tree in the parent's chilren array
+ *     board - the new node's position: the parent's with the move made, or
+ *             the parent's as it is if the move is an amazon move
  */
-MoveTree::MoveTree(MoveTree *parent, move_t move) {
+MoveTree::MoveTree(MoveTree *parent, packed_move_t move, Board& board) {
     this->parent = parent;
     this->prev_move = move;
+    this->position = NULL;
+    this->split_moves = parent->split_moves;
+    this->arrow_pending = parent->opens_amazon_moves();
+    // until the arrow lands, the position and the player to move are the parent's
+    this->player = this->arrow_pending ? parent->player : !parent->player;
+    // an amazon that could move can always shoot back at the square she left
+    this->has_moves = this->arrow_pending || !board.no_moves(this->player);
+    this->key = board.position_key(this->player);
 
-    this->board = parent->board.make_move_immutably(parent->player, move);
-    this->player = !(parent->player);
+    this->arena = parent->arena;
+    this->owns_arena = false;
+    this->transpositions = parent->transpositions;
+    this->owns_transpositions = false;
+    this->shared_stats = NULL;
+    if(this->transpositions != NULL && !this->arrow_pending)
+        this->shared_stats = this->transpositions->entry(this->position_key());
+    this->eval_cache = parent->eval_cache;
+    this->owns_eval_cache = false;
 
-    this->num_moves = this->board.find_num_moves(this->player);
-    this->children = std::vector<MoveTree*>();
-    this->child_indices = std::unordered_set<int>();
+    this->first_child = NULL;
+    this->next_sibling = NULL;
+    this->num_children = 0;
+    this->num_moves = MOVES_UNCOUNTED;
+    this->expansion_lock.clear();
     
     this->num_wins = 0;
     this->num_rollouts = 0;
+    this->prior = 1; // set by open_new_node() if the policy uses priors
+    // an amazon move's position is its parent's, which the solver already
+    // looked at and couldn't decide, or the parent wouldn't have children
+    this->endgame = this->arrow_pending ? endgame_unsolved : ENDGAME_UNCHECKED;
+}
+
+/*
+ * Constructor used to copy a node into another arena when the tree is
+ * trimmed. Copies everything but the links to other nodes
+ *
+ * Params:
+ *     original - the node to copy
+ *     parent - the parent of the copy
+ */
+MoveTree::MoveTree(const MoveTree& original, MoveTree *parent) {
+    this->parent = parent;
+    this->position = NULL;
+    this->arena = parent->arena;
+    this->owns_arena = false;
+    this->transpositions = parent->transpositions;
+    this->owns_transpositions = false;
+    this->shared_stats = (original.transpositions == this->transpositions) ? original.shared_stats : NULL;
+    this->eval_cache = parent->eval_cache;
+    this->owns_eval_cache = false;
+    this->first_child = NULL;
+    this->next_sibling = NULL;
+    this->expansion_lock.clear();
+
+    this->copy_node_fields(original);
 }
 
 /*
  * MoveTree destructor
- * Recursively destroys children too
+ * Nodes live in the arena and are never destroyed one at a time, so
+ * freeing the whole tree is just freeing the arena (if this tree owns it)
  */
 MoveTree::~MoveTree() {
-    for(MoveTree *child : children) {
-        delete child;
+    delete this->position;
+    if(this->owns_arena)
+        delete this->arena;
+    if(this->owns_transpositions)
+        delete this->transpositions;
+    if(this->owns_eval_cache)
+        delete this->eval_cache;
+}
+
+/*
+ * Copies the position, statistics and expansion state of another node
+ * into this one. Leaves the links to other nodes alone
+ *
+ * Params:
+ *     original - the node to copy from
+ * Return: none
+ */
+void MoveTree::copy_node_fields(const MoveTree& original) {
+    this->prev_move = original.prev_move;
+    this->player = original.player;
+    this->split_moves = original.split_moves;
+    this->arrow_pending = original.arrow_pending;
+    this->has_moves = original.has_moves;
+    this->key = original.key;
+
+    this->num_children = original.num_children;
+    this->num_moves = original.num_moves;
+    std::copy(original.amazon_moves, original.amazon_moves + AMAZONS_PER_PLAYER, this->amazon_moves);
+    this->expansion_offset = original.expansion_offset;
+    this->expansion_stride = original.expansion_stride;
+    this->opened_ahead = original.opened_ahead;
+
+    this->num_wins = original.num_wins.load();
+    this->num_rollouts = original.num_rollouts.load();
+    this->prior = original.prior;
+    this->endgame = original.endgame.load();
+}
+
+/*
+ * Copies the children of another node, and everything below them, into
+ * this node's arena as children of this node
+ *
+ * Params:
+ *     original - the node whose descendants to copy
+ * Return: none
+ */
+void MoveTree::copy_children(const MoveTree& original) {
+    MoveTree **tail = &this->first_child; // keeps the children in their original order
+
+    for(MoveTree *child = original.first_child; child != NULL; child = child->next_sibling) {
+        *tail = this->arena->allocate(*child, this);
+        (*tail)->copy_children(*child);
+        tail = &(*tail)->next_sibling;
+    }
+    *tail = NULL;
+}
+
+/*
+ * Follows a move made in the game: the child for that move becomes the
+ * root, keeping its statistics and subtree, and the rest of the tree is
+ * freed. If the move has no child yet, the tree starts over from the new
+ * position. Called after every move, by either player, so that the tree
+ * always matches the game board
+ *
+ * Precondition: this is the root of a tree which owns its arena, and no
+ *               search is running on it
+ *
+ * Params:
+ *     move - the move made from this tree's position
+ * Return: none
+ */
+void MoveTree::advance(packed_move_t move) {
+    NodeArena<MoveTree> *old_arena = this->arena;
+    MoveTree *match = this->find_child(move);
+
+    assert(this->owns_arena);
+    if(match != NULL && match->arrow_pending) // the amazon move's node, then the arrow's
+        match = match->find_child(move);
+
+    // the kept subtree is copied into a fresh arena, so that everything else
+    // is freed in one go with the old one
+    this->arena = new NodeArena<MoveTree>();
+    this->position->do_move(this->player, move); // the root is the only node with a position to keep up to date
+    if(match != NULL) {
+        this->copy_node_fields(*match);
+        this->copy_children(*match);
+        this->count_moves_once(*this->position); // the new root may never have been expanded
+    } else {
+        this->player = !this->player;
+        this->has_moves = !this->position->no_moves(this->player);
+        this->key = this->position->position_key(this->player);
+        this->prev_move = move;
+        this->first_child = NULL;
+        this->num_children = 0;
+        this->count_moves(*this->position);
+        this->num_wins = 0;
+        this->num_rollouts = 0;
+        this->endgame = ENDGAME_UNCHECKED;
     }
+    delete old_arena;
 }
 
 /*
- * Updates this node's counts according to the result of this rollout
+ * Has this node and everything below it use the passed tables
+ *
+ * Params:
+ *     transpositions - the transposition table to share statistics through, or NULL
+ *     eval_cache - the cache of leaf scores to use, or NULL
+ * Return: none
+ */
+void MoveTree::attach_tables(TranspositionTable *transpositions, EvalCache *eval_cache) {
+    if(transpositions != this->transpositions) {
+        this->transpositions = transpositions;
+        this->shared_stats = NULL;
+        if(transpositions != NULL && this->parent != this && !this->arrow_pending)
+            this->shared_stats = transpositions->entry(this->position_key());
+    }
+    this->eval_cache = eval_cache;
+    for(MoveTree *child = this->first_child; child != NULL; child = child->next_sibling) {
+        child->attach_tables(transpositions, eval_cache);
+    }
+}
+
+/*
+ * Sets num_moves to the number of children this node can have: its
+ * player's legal moves, or with split moves, the amazon moves, or the
+ * arrows of the amazon move that led here. Fills amazon_moves, and picks
+ * the order the children are opened in
+ *
+ * Precondition: no other thread can see the node, or the caller holds its lock
+ *
+ * Params:
+ *     board - this node's position
+ * Return: none
+ */
+void MoveTree::count_moves(Board& board) {
+    if(this->arrow_pending) {
+        this->num_moves = this->arrow_squares(board).count();
+    } else {
+        Bitboard amazons = board.get_amazons(this->player);
+        int count = 0;
+        for(int i=0; amazons.any(); i++) {
+            int amazon = amazons.pop_lowest();
+            this->amazon_moves[i] = this->split_moves ? board.queen_attacks(amazon).count()
+                                                      : board.count_amazon_moves(amazon);
+            count += this->amazon_moves[i];
+        }
+        this->num_moves = count;
+    }
+    this->choose_expansion_order();
+}
+
+/*
+ * Finds the move for this node's nth child, in the order count_moves()
+ * counts them, without building a list of moves
+ *
+ * Precondition: 0 <= n < num_moves, which have been counted
+ *
+ * Params:
+ *     board - this node's position
+ *     n - the index of the move
+ * Return: a packed_move_t - the move. An amazon move has no arrow (arrow square 0)
+ */
+packed_move_t MoveTree::nth_child_move(Board& board, int n) const {
+    if(this->arrow_pending) {
+        return pack_move(move_old_loc(this->prev_move), move_new_loc(this->prev_move),
+                         this->arrow_squares(board).nth_set(n));
+    }
+    if(!this->split_moves)
+        return board.nth_move(this->player, n, this->amazon_moves);
+
+    // an amazon move is one of her destinations, without an arrow
+    Bitboard amazons = board.get_amazons(this->player);
+    for(int i=0; ; i++) {
+        int amazon = amazons.pop_lowest();
+        if(n < this->amazon_moves[i])
+            return pack_move(amazon, board.queen_attacks(amazon).nth_set(n), 0);
+        n -= this->amazon_moves[i];
+    }
+}
+
+// the squares the amazon of prev_move can shoot at on board, for a node whose arrow is pending
+Bitboard MoveTree::arrow_squares(const Board& board) const {
+    Bitboard empty = ~board.get_occupied();
+    empty.set(move_old_loc(this->prev_move)); // the amazon has left her square
+    return Bitboard::queen_attacks(Bitboard::square(move_new_loc(this->prev_move)), empty);
+}
+
+/*
+ * Finds the child for a move made from this node. With split moves, a
+ * full move finds the node of its amazon move
+ *
+ * Params:
+ *     move - the move
+ * Return: the child, or NULL if it hasn't been opened
+ */
+MoveTree *MoveTree::find_child(packed_move_t move) const {
+    if(this->opens_amazon_moves())
+        move = pack_move(move_old_loc(move), move_new_loc(move), 0);
+    for(MoveTree *child = this->first_child; child != NULL; child = child->next_sibling) {
+        if(child->prev_move == move)
+            return child;
+    }
+    return NULL;
+}
+
+/*
+ * Switches a root between opening full moves and split moves. Its
+ * children are dropped, since they are of the other kind; they stay in
+ * the arena until the tree is next trimmed
+ *
+ * Params:
+ *     split - whether to split moves
+ * Return: none
+ */
+void MoveTree::set_split_moves(bool split) {
+    this->split_moves = split;
+    this->first_child = NULL;
+    this->num_children = 0;
+    this->count_moves(*this->position);
+}
+
+// picks a random order in which to open this node's children
+void MoveTree::choose_expansion_order() {
+    this->opened_ahead = 0;
+    if(this->num_moves <= 1) {
+        this->expansion_offset = 0;
+        this->expansion_stride = 1;
+        return;
+    }
+
+    this->expansion_offset = fast_rand() % this->num_moves;
+    do {
+        this->expansion_stride = 1 + fast_rand() % (this->num_moves - 1);
+    } while(gcd(this->expansion_stride, this->num_moves) != 1);
+}
+
+/*
+ * Updates this node's counts according to the result of this rollout, and
+ * takes back the virtual loss charged when the rollout passed through
  *
  * Params:
  *     eval - the evaluation of the final position of a rollout
  * Return: none
  */
 inline void MoveTree::update_counters(int eval) {
-    this->num_rollouts++;
-    if(first_better(this->player, 0, eval))  { 
-        // if the player who moved to this position won (aka position is bad for current player)
-        this->num_wins++;
+    bool won = this->mover_won(eval);
+
+    if(1 - VIRTUAL_LOSS != 0)
+        this->num_rollouts.fetch_add(1 - VIRTUAL_LOSS, std::memory_order_relaxed);
+    if(won)
+        this->num_wins.fetch_add(1, std::memory_order_relaxed);
+    if(this->shared_stats != NULL)
+        TranspositionTable::add(this->shared_stats, this->position_key(), won, 1 - VIRTUAL_LOSS);
+}
+
+/*
+ * Evaluates a position at the end of a rollout once the endgame solver
+ * has looked at it, and stores the evaluation in the cache, if there is
+ * one. The moves are only counted if the evaluator needs them, and the
+ * cache is only given the count if they were
+ *
+ * Params:
+ *     board - the position
+ *     player - the player to move
+ *     key - the position's key in the cache
+ *     verdict - what the endgame solver found
+ *     evaluator - the heuristic to use, if the solver couldn't decide
+ * Return: an int - the more positive, the better for left
+ */
+template<class E>
+int MoveTree::evaluate_leaf(Board& board, player_t player, uint64_t key, endgame_verdict_t verdict,
+                            const E& evaluator) {
+    EvalState state;
+    bool counted = E::needs_state && verdict == endgame_unsolved;
+    int eval;
+
+    if(verdict != endgame_unsolved) {
+        eval = verdict_eval(verdict);
+    } else if(counted) {
+        state = EvalState(board);
+        eval = evaluator.evaluate(board, state);
+    } else {
+        eval = evaluator.evaluate(board);
+    }
+    if(this->eval_cache != NULL) {
+        int num_moves = counted ? state.get_num_moves(player) : EVAL_CACHE_UNCOUNTED;
+        this->eval_cache->store(key, eval, num_moves);
+    }
+    return eval;
+}
+
+/*
+ * Scores this node's position at the end of a rollout: exactly, if the
+ * endgame solver can decide it, and with the heuristic otherwise. The
+ * solver's verdict is kept, so it runs once per node, and with an
+ * evaluation cache a position scored before costs one lookup
+ *
+ * Params:
+ *     board - this node's position
+ *     evaluator - the heuristic to use
+ * Return: an int - the more positive, the better for left
+ */
+template<class E>
+int MoveTree::score(Board& board, const E& evaluator) {
+    signed char verdict = this->endgame.load(std::memory_order_relaxed);
+    int eval;
+    int cached_moves;
+
+    if(verdict > endgame_unsolved)
+        return verdict_eval(verdict);
+    if(this->eval_cache != NULL && this->eval_cache->probe(this->position_key(), &eval, &cached_moves)) {
+#ifdef EVAL_CROSSCHECK
+        if(cached_moves != EVAL_CACHE_UNCOUNTED && cached_moves != board.find_num_moves(this->player)) {
+            fprintf(stderr, "MoveTree score: cached move count %d, position has %d\n",
+                    cached_moves, board.find_num_moves(this->player));
+            abort();
+        }
+#endif
+        return eval;
+    }
+
+    if(verdict == ENDGAME_UNCHECKED) {
+        verdict = solve_endgame(board, this->player, ENDGAME_LEAF_NODES).verdict;
+        this->endgame.store(verdict, std::memory_order_relaxed);
+    }
+    return this->evaluate_leaf(board, this->player, this->position_key(), (endgame_verdict_t)verdict, evaluator);
+}
+
+/*
+ * Records the result of a rollout in this node and every node above it,
+ * without touching virtual losses. Used for the extra results of a
+ * leaf_parallel batch, which don't travel back up the recursion
+ *
+ * Params:
+ *     eval - the evaluation of the final position of a rollout
+ * Return: none
+ */
+void MoveTree::back_up(int eval) {
+    MoveTree *node = this;
+
+    while(true) {
+        bool won = node->mover_won(eval);
+        node->num_rollouts.fetch_add(1, std::memory_order_relaxed);
+        if(won)
+            node->num_wins.fetch_add(1, std::memory_order_relaxed);
+        if(node->shared_stats != NULL)
+            TranspositionTable::add(node->shared_stats, node->position_key(), won, 1);
+        if(node->parent == node) // the root is its own parent
+            break;
+        node = node->parent;
     }
 }
 
 /*
  * Calculates how favorable it is to continue to this node during a rollout
  * Favorability, or "promise", is a combination of how strong the move to
- * this position is for the mover to it, and how unexplored this node is
+ * this position is for the mover to it, and how unexplored this node is.
+ * In DAG mode the statistics of the position are used, from every node
+ * that reached it
  *
- * Params: none
+ * Params:
+ *     policy - the rule to score by
+ *     parent_term - policy.parent_term() of the parent's visits
  * Return: a float - the higher, the more promising this node is
  */
-inline float MoveTree::promise() {
-    float exploration = 1 / (log(this->num_rollouts + 1) + 1);
-    float exploitation = 1/2; // default for no rollouts
-    if(this->num_rollouts > 0) { // we can divide by num_rollouts
-        exploitation = (float)this->num_wins / this->num_rollouts;
-    }
-    return exploration + exploitation;
+inline float MoveTree::promise(const SelectionPolicy& policy, float parent_term) {
+    int wins;
+    int rollouts;
+    this->read_stats(&wins, &rollouts);
+    return policy.child_score(wins, rollouts, this->prior, parent_term);
 }
 
 /*
- * Returns the index in the children list of the node which should continue 
- * the rollout, as calculated by the promise() method
+ * Returns the child which should continue the rollout, as calculated by 
+ * the promise() method
  * If there's a tie, randomly selects one of the tied best children
  *
- * Params: none
- * Return: an int - the index of the most lucrative continuation
+ * Precondition: this node has children
+ *
+ * Params:
+ *     policy - the rule to score the children by
+ * Return: a pointer to the most lucrative continuation
  */
-int MoveTree::most_promising_index(float floor) {
-    std::vector<int> best_indices;
-    float greatest_promise = floor;
-    float current_promise;
+MoveTree *MoveTree::most_promising_child(const SelectionPolicy& policy) {
+    int wins;
+    int rollouts;
+    this->read_stats(&wins, &rollouts);
+    float parent_term = policy.parent_term(std::max(rollouts, 1));
 
-    for(int i=0; i < (int)this->children.size(); i++) {
-        current_promise = this->children[i]->promise();
-        if(current_promise > greatest_promise) {
+    MoveTree *best = NULL;
+    float greatest_promise = 0;
+    int num_tied = 0;
+    for(MoveTree *child = this->first_child; child != NULL; child = child->next_sibling) {
+        float current_promise = child->promise(policy, parent_term);
+        if(best == NULL || current_promise > greatest_promise) {
+            best = child;
             greatest_promise = current_promise;
-            best_indices.clear();
-            best_indices.push_back(i);
-        }
-        if(current_promise == greatest_promise) {
-            best_indices.push_back(i);
+            num_tied = 1;
+        } else if(current_promise == greatest_promise && fast_rand() % ++num_tied == 0) {
+            best = child; // each of the tied children ends up picked with equal chance
         }
     }
-    if(best_indices.empty())
-        return -1;
-    return best_indices[rand() % best_indices.size()];
+    return best;
 }
 
 /*
- * Constructs a child node, randomly selected from the moves from this position
- * for which we haven't yet constructed a child. Also adds the index in of it
- * (in the list returned from this->board.get_moves()) to the child_indices set
+ * For puct_policy: picks the unopened move with the best prior among
+ * the first PRIOR_CANDIDATES of the expansion order, and marks it opened.
+ * The candidates' mobility is counted together, with one call to
+ * classic_child_terms()
  *
- * Params: none
- * Return: none
+ * Params:
+ *     board - this node's position, left as it was
+ *     mobility_gain - set to the picked move's mobility gain, for its prior
+ * Return: the move to open
  */
-void MoveTree::open_new_node() {
-    int num_options = this->num_moves - this->children.size();
-    assert(num_options > 0);
-    int random_index = rand() % num_options;
-
-    std::vector<move_t> moves = this->board.get_moves(this->player);
-    int j=0;
-    for(int i=0; i < (int)moves.size(); i++) {
-        if(this->child_indices.count(i)) continue;
-        if(j == random_index) {
-            this->children.push_back(new MoveTree(this, moves[i]));
-            this->child_indices.insert(i);
-            break;
+packed_move_t MoveTree::pick_prior_candidate(Board& board, int *mobility_gain) {
+    // every move before front in the order is open, and front itself isn't
+    int front = this->num_children - __builtin_popcount(this->opened_ahead);
+    int num_candidates = std::min(PRIOR_CANDIDATES, this->num_moves - front);
+    packed_move_t candidates[PRIOR_CANDIDATES] = {};
+    int slots[PRIOR_CANDIDATES];
+    int num_unopened = 0;
+
+    for(int j=0; j < num_candidates; j++) {
+        if(!(this->opened_ahead & (1 << j))) {
+            candidates[num_unopened] = this->nth_child_move(board, this->expansion_index(front + j));
+            slots[num_unopened++] = j;
         }
-        j++;
     }
+
+    int move_diffs[PRIOR_CANDIDATES];
+    int access_diffs[PRIOR_CANDIDATES];
+    classic_child_terms(board, this->player, candidates, num_unopened, move_diffs, access_diffs);
+    // the terms are left's minus right's, and the gain is the mover's
+    int sign = (this->player == LEFT) ? 1 : -1;
+    int margin_before = board.find_num_moves(this->player) - board.find_num_moves(!this->player);
+    int best = 0;
+    for(int i=1; i < num_unopened; i++) {
+        if(move_diffs[i] * sign > move_diffs[best] * sign)
+            best = i;
+    }
+    *mobility_gain = move_diffs[best] * sign - margin_before;
+
+    this->opened_ahead |= 1 << slots[best];
+    while(this->opened_ahead & 1) // the front moves up past every move opened
+        this->opened_ahead >>= 1;
+    return candidates[best];
+}
+
+/*
+ * Constructs a child node for the next move in this node's expansion
+ * order, or under puct_policy for the best prior of the next few. The
+ * move is looked up with nth_child_move(), so the list is never built.
+ * The move is made on board for the child and taken back after
+ *
+ * Params:
+ *     board - this node's position
+ *     policy - the rule the child will be selected by, which may want its prior
+ * Return: a pointer to the new child
+ */
+MoveTree *MoveTree::open_new_node(Board& board, const SelectionPolicy& policy) {
+    assert(this->num_children < this->num_moves);
+    MoveTree *child;
+
+    if(this->opens_amazon_moves()) { // the position is unchanged until the arrow lands, so the prior is the average
+        packed_move_t move = this->nth_child_move(board, this->expansion_index(this->num_children));
+        child = this->arena->allocate(this, move, board);
+    } else if(policy.uses_priors()) {
+        int mobility_gain;
+        packed_move_t move = this->pick_prior_candidate(board, &mobility_gain);
+        board.do_move(this->player, move);
+        child = this->arena->allocate(this, move, board);
+        child->prior = SelectionPolicy::prior_weight(mobility_gain);
+        board.undo_move(this->player, move);
+    } else {
+        packed_move_t move = this->nth_child_move(board, this->expansion_index(this->num_children));
+        board.do_move(this->player, move);
+        child = this->arena->allocate(this, move, board);
+        board.undo_move(this->player, move);
+    }
+    child->next_sibling = this->first_child;
+    this->first_child = child;
+    this->num_children++;
+    return child;
+}
+
+/*
+ * Picks the child to continue a rollout from (opening a new one if the
+ * policy allows another) while holding this node's lock, and charges it
+ * a virtual loss before letting other threads in
+ *
+ * Params:
+ *     board - this node's position
+ *     policy - the rule to select by
+ * Return: the child to descend into
+ */
+MoveTree *MoveTree::select_child(Board& board, const SelectionPolicy& policy) {
+    MoveTree *next;
+
+    this->lock();
+    this->count_moves_once(board);
+    // widening goes by this node's own visits, since the children are its own
+    if(this->num_children < this->num_moves
+       && policy.may_widen(this->num_rollouts.load(std::memory_order_relaxed), this->num_children))
+        next = this->open_new_node(board, policy);
+    else
+        next = this->most_promising_child(policy);
+    next->add_virtual_loss();
+    this->unlock();
+
+    return next;
+}
+
+/*
+ * The playout phase of a rollout: plays depth moves on a scratch copy
+ * of this node's position, picked by playout_move(), and scores the final
+ * position like score() does. None of the positions become nodes
+ *
+ * Params:
+ *     position - this node's position
+ *     depth - the moves to play
+ *     evaluator - the heuristic to score the final position with
+ * Return: an int - the more positive, the better for left
+ */
+template<class E>
+int MoveTree::playout(const Board& position, int depth, const E& evaluator) {
+    Board board = position;
+    player_t player = this->player;
+
+    // the picked moves are legal by construction, so they are made unchecked
+    if(this->arrow_pending) { // the amazon has moved, and her arrow is the playout's first move
+        board.do_move(player, playout_arrow(board, player, this->prev_move));
+        player = !player;
+        depth--;
+    }
+    for(; depth > 0; depth--) {
+        packed_move_t move = playout_move(board, player);
+        if(move == NO_MOVE) // player loses
+            return worst_eval(player);
+        board.do_move(player, move);
+        player = !player;
+    }
+
+    uint64_t key = board.position_key(player);
+    int eval;
+    int cached_moves;
+    if(this->eval_cache != NULL && this->eval_cache->probe(key, &eval, &cached_moves))
+        return eval;
+
+    endgame_verdict_t verdict = solve_endgame(board, player, ENDGAME_LEAF_NODES).verdict;
+    return this->evaluate_leaf(board, player, key, verdict, evaluator);
+}
+
+/*
+ * The playout phase of a leaf_parallel rollout: plays this leaf out
+ * once per pool thread, all at once, and backs every result up the tree
+ *
+ * Params:
+ *     board - this node's position
+ *     depth - the moves to play in each playout
+ *     evaluator - the heuristic to score the playouts with
+ *     leaf_pool - the threads to play out with
+ * Return: an int - the evaluation of the first playout, which is backed
+ *         up through the rollout recursion like a normal result
+ */
+template<class E>
+int MoveTree::playout_leaves(const Board& board, int depth, const E& evaluator, LeafPool *leaf_pool) {
+    int num_playouts = leaf_pool->size();
+    int *evals = leaf_pool->eval_buffer();
+
+    leaf_pool->evaluate(this, board, depth, evals, num_playouts, evaluator);
+
+    for(int i=1; i < num_playouts; i++) {
+        this->back_up(evals[i]);
+    }
+    return evals[0];
 }
 
 /*
  * Simulates a semirandom continuation of the game. Updates the counters
  * of the positions reached in this simulation based on whether the end 
- * result was good or bad for the player whose turn it was in that position
+ * result was good or bad for the player whose turn it was in that position.
+ * The tree is descended to the first node the simulation reaches for the
+ * first time, and the rest of the moves are played out from there, so
+ * each rollout adds one node to the tree
  *
  * Params:
+ *     board - this node's position. The moves made on it on the way
+ *             down are taken back on the way up
  *     depth - the number of moves to simulate before evaluating the position
+ *     evaluator - the heuristic to evaluate the final position with
+ *     policy - the rule to descend the tree by
+ *     leaf_pool - the threads to play leaves out with, or NULL outside leaf_parallel mode
  * Return: an int - the evaluation of the final position of the simulation
  */
-int MoveTree::rollout(int depth) {
-    int continuation_index;
+template<class E>
+int MoveTree::rollout(Board& board, int depth, const E& evaluator, const SelectionPolicy& policy,
+                      LeafPool *leaf_pool) {
     int eval;
+    signed char verdict = this->endgame.load(std::memory_order_relaxed);
 
+    // a solved position is final, except at the root, which still needs children to pick from
+    if(verdict > endgame_unsolved && this->parent != this) {
+        eval = verdict_eval(verdict);
+        this->update_counters(eval);
+        return eval;
+    }
     if(depth == 0) {
-        eval = this->board.evaluate();
+        eval = this->score(board, evaluator);
         this->update_counters(eval);
         return eval;
     }
-    if(this->num_moves == 0) { // no moves; this->player loses
+    if(!this->has_moves) { // no moves; this->player loses
         update_counters(worst_eval(this->player));
         return worst_eval(this->player);
     }
 
-    // if there are moves that we haven't considered, include them in the search by 
-    // starting with 1.5 promise (the promise of a node with no rollouts)
-    continuation_index = this->most_promising_index(num_moves == (int)children.size() ? 0 : 1.5);
-    if(continuation_index == -1) { // we should explore a new node
-        this->open_new_node(); // will push new node to back of children list
-        assert(!this->children.empty());
-        eval = this->children.back()->rollout(depth - 1); // children.back() is new node
-    } else { // use the node we just got an index for
-        eval = this->children[continuation_index]->rollout(depth - 1);
+    // the virtual loss charged on the way down is the only rollout a new leaf has
+    bool new_leaf = (this->parent != this && this->num_rollouts.load(std::memory_order_relaxed) <= VIRTUAL_LOSS);
+    if(new_leaf && verdict == ENDGAME_UNCHECKED) {
+        verdict = solve_endgame(board, this->player, ENDGAME_LEAF_NODES).verdict;
+        this->endgame.store(verdict, std::memory_order_relaxed);
+    }
+
+    if(new_leaf && verdict > endgame_unsolved) {
+        eval = verdict_eval(verdict);
+    } else if(new_leaf) {
+        eval = (leaf_pool != NULL) ? this->playout_leaves(board, depth, evaluator, leaf_pool)
+                                   : this->playout(board, depth, evaluator);
+    } else {
+        // an amazon move and its arrow make up one move of the depth between them
+        int child_depth = this->opens_amazon_moves() ? depth : depth - 1;
+        MoveTree *child = this->select_child(board, policy);
+        if(child->arrow_pending) { // the amazon move's node shares this node's position
+            eval = child->rollout(board, child_depth, evaluator, policy, leaf_pool);
+        } else {
+            board.do_move(this->player, child->prev_move);
+            eval = child->rollout(board, child_depth, evaluator, policy, leaf_pool);
+            board.undo_move(this->player, child->prev_move);
+        }
     }
 
     this->update_counters(eval);
@@ -192,60 +890,312 @@ int MoveTree::rollout(int depth) {
  * Finds the best move in the position based on the results of MCTS
  *
  * Params: none
- * Returns: an int - the index of the best move in the children list
+ * Returns: a pointer to the child the best move leads to
  */
-int MoveTree::best_move_index() {
+MoveTree *MoveTree::best_child() {
     int most_wins = 0;
-    int index = 0;
+    MoveTree *best = this->first_child;
 
-    for(uint i=0; i < this->children.size(); i++) {
-        if(this->children[i]->num_wins > most_wins) {
-            most_wins = this->children[i]->num_wins;
-            index = i;
+    for(MoveTree *child = this->first_child; child != NULL; child = child->next_sibling) {
+        int wins = child->num_wins.load(std::memory_order_relaxed);
+        if(wins > most_wins) {
+            most_wins = wins;
+            best = child;
         }
     }
-    return index;
+    return best;
 }
 
 /*
- * The AI makes a move on board. It then trims the move tree to only contain
- * nodes decending from the new position (the rest of the tree is freed)
- * Usage: tree.make_move_and_die(board, &tree);
+ * The AI searches the position and makes its move on board. The tree is
+ * not trimmed; call advance() with the move afterwards. If the endgame
+ * solver can pick the move, there is no search
  *
  * Params: 
  *     board - the main game board on which the AI will move
- * Returns: none - the object calling this method deletes itself, so it can't return
+ *     config - the settings to search with
+ * Returns: the move the AI made
  */
-move_t MoveTree::make_move(Board& board) {
+move_t MoveTree::make_move(Board& board, const ai_config_t& config) {
+    // a decided endgame needs no search
+    endgame_result_t endgame = solve_endgame(*this->position, this->player, ENDGAME_ROOT_NODES);
+    if(endgame.move != NO_MOVE) {
+        bool legal = board.make_move(this->player, endgame.move);
+        assert(legal);
+        return unpack_move(endgame.move);
+    }
+
     // do MCTS
-    this->think();
+    this->think(config);
 
     // make the move
-    int child_index = this->best_move_index();
-    assert(board.make_move(this->player, this->children[child_index]->prev_move));
+    MoveTree *best = this->best_child();
+    if(best->arrow_pending) { // the best amazon move, then the best arrow for it
+        if(best->first_child == NULL) { // it was only ever played out
+            best->count_moves_once(*this->position);
+            best->open_new_node(*this->position, SelectionPolicy(config.selection));
+        }
+        best = best->best_child();
+    }
+    bool legal = board.make_move(this->player, best->prev_move);
+    assert(legal);
 
-    return this->children[child_index]->prev_move;
+    return unpack_move(best->prev_move);
 }
 
-// returns whether two moves are the same (insofar as Board::make_move() is concerned)
-bool moves_equal(move_t move_1, move_t move_2) {
-    if(!move_1.old_loc.equals(move_2.old_loc)) return false;
-    if(!move_1.new_loc.equals(move_2.new_loc)) return false;
-    if(!move_1.arrow.equals(move_2.arrow)) return false;
-    return true;
+/*
+ * The loop run by each searching thread: does rollouts from this node
+ * until the controller ends the search
+ *
+ * Params:
+ *     controller - decides when the search is over, shared by all threads
+ *     evaluator - the heuristic to evaluate leaves with
+ *     policy - the rule to descend the tree by
+ *     seed - the seed for this thread's random number generator
+ *     leaf_pool - the threads to play leaves out with, or NULL outside leaf_parallel mode
+ *     reports - whether this thread reports the search's progress to the
+ *               controller's monitor. True for one thread only
+ * Return: none
+ */
+template<class E>
+void MoveTree::search_worker(SearchController *controller, const E *evaluator, const SelectionPolicy *policy,
+                             uint64_t seed, LeafPool *leaf_pool, bool reports) {
+    int results_per_rollout = (leaf_pool != NULL) ? leaf_pool->size() : 1;
+    int since_check = 0;
+    Board board = *this->position; // the rollouts make and take back their moves on this copy
+
+    seed_fast_rand(seed);
+
+    while(controller->start_rollout(this->arena->bytes())) {
+        this->add_virtual_loss(); // so that update_counters() treats the root like any other node
+        this->rollout(board, SEARCH_DEPTH, *evaluator, *policy, leaf_pool);
+
+        if(++since_check == DECISION_CHECK_INTERVAL) {
+            since_check = 0;
+            if(controller->early_stop_allowed()
+               && this->best_move_decided(controller->rollouts_left() * results_per_rollout))
+                controller->stop();
+            if(reports && controller->report_due())
+                this->report_progress(*controller);
+        }
+    }
 }
 
 /*
- * A few seconds are spent evaluating the moves using MCTS
+ * Reports the move best_child() would pick so far, and the share of
+ * its rollouts won, to the controller's monitor. Safe to call while
+ * other threads search the tree
  *
- * Params: none
+ * Params:
+ *     controller - the controller of the running search
  * Return: none
  */
-void MoveTree::think() {
-    printf("The computer is thinking...\n");
+void MoveTree::report_progress(const SearchController& controller) {
+    search_info_t info = {};
+    MoveTree *best;
+
+    this->lock();
+    best = this->best_child();
+    this->unlock();
 
-    for(int i=0; i < ROLLOUTS; i++) {
-        this->rollout(SEARCH_DEPTH);
+    if(best != NULL) {
+        int visits = best->num_rollouts.load(std::memory_order_relaxed);
+        if(visits > 0)
+            info.win_rate = (double)best->num_wins.load(std::memory_order_relaxed) / visits;
+        info.best_move = best->prev_move;
+        if(best->arrow_pending) { // the arrow is a level further down, if it has been opened
+            MoveTree *arrow;
+            best->lock();
+            arrow = best->best_child();
+            best->unlock();
+            info.best_move = (arrow != NULL) ? arrow->prev_move : NO_MOVE;
+        }
     }
+    info.nodes = controller.rollouts();
+    controller.report(info);
 }
 
+/*
+ * Determines whether the move best_child() would pick is settled: no
+ * other child could catch up with its wins in the results still to come
+ *
+ * Params:
+ *     results_left - the most rollout results the search can still back up
+ * Return: a bool - true if more searching can't change the move picked
+ */
+bool MoveTree::best_move_decided(long results_left) {
+    int most_wins = 0;
+    int runner_up_wins = 0; // moves without a child yet have no wins
+    MoveTree *best = this->first_child;
+    int num_moves;
+
+    this->lock();
+    num_moves = this->num_moves;
+    for(MoveTree *child = this->first_child; child != NULL; child = child->next_sibling) {
+        int wins = child->num_wins.load(std::memory_order_relaxed);
+        if(wins > most_wins) {
+            runner_up_wins = most_wins;
+            most_wins = wins;
+            best = child;
+        } else if(wins > runner_up_wins) {
+            runner_up_wins = wins;
+        }
+    }
+    this->unlock();
+
+    // an amazon move no rollout has expanded yet has no arrow to settle on
+    if(num_moves == MOVES_UNCOUNTED)
+        return false;
+    if(num_moves > 1 && most_wins - runner_up_wins <= results_left)
+        return false;
+    // with split moves, the best amazon move's arrow has to be settled too
+    return best == NULL || !best->arrow_pending || best->best_move_decided(results_left);
+}
+
+/*
+ * Merges the results of another search of the same position into this
+ * one, for root_parallel mode. Root children for the same move have their
+ * counts added together; root children this tree lacks are moved over.
+ * Leaves other with no children
+ *
+ * Params:
+ *     other - a tree with the same board and player as this one
+ * Return: none
+ */
+void MoveTree::merge_root(MoveTree& other) {
+    std::unordered_map<packed_move_t, MoveTree *> children_by_move;
+    MoveTree *next;
+
+    for(MoveTree *child = this->first_child; child != NULL; child = child->next_sibling) {
+        children_by_move[child->prev_move] = child;
+    }
+
+    // both trees opened children in the same order, so the children this tree
+    // lacks are the ones past the end of its own expansion
+    for(MoveTree *child = other.first_child; child != NULL; child = next) {
+        auto match = children_by_move.find(child->prev_move);
+        next = child->next_sibling;
+
+        if(match != children_by_move.end()) {
+            match->second->num_wins += child->num_wins;
+            match->second->num_rollouts += child->num_rollouts;
+        } else {
+            child->parent = this;
+            child->next_sibling = this->first_child;
+            this->first_child = child;
+        }
+    }
+    if(other.num_children > this->num_children) { // the opened moves are a prefix of the same picks
+        this->num_children = other.num_children;
+        this->opened_ahead = other.opened_ahead;
+    }
+    other.first_child = NULL;
+    other.num_children = 0;
+
+    this->num_wins += other.num_wins;
+    this->num_rollouts += other.num_rollouts;
+}
+
+/*
+ * The body of think(), once the evaluator is picked. Every function the
+ * search calls per rollout is instantiated for E, so the evaluation is
+ * a direct call
+ *
+ * Params:
+ *     config - the settings to search with
+ *     evaluator - the heuristic to evaluate leaves with
+ * Return: none
+ */
+template<class E>
+void MoveTree::search(const ai_config_t& config, const E& evaluator) {
+    SearchController controller(config.limits, this->position->num_empty_squares(), config.monitor);
+    SelectionPolicy policy(config.selection);
+    std::vector<std::thread> helpers;
+    std::vector<MoveTree *> ensemble; // the extra trees searched in root_parallel mode
+
+    switch(config.parallel_mode) {
+        case tree_parallel:
+            for(int i=1; i < config.num_threads; i++) {
+                helpers.push_back(std::thread(&MoveTree::search_worker<E>, this, &controller, &evaluator,
+                                              &policy, (uint64_t)fast_rand(), (LeafPool *)NULL, false));
+            }
+            this->search_worker(&controller, &evaluator, &policy, (uint64_t)fast_rand(), NULL, true);
+            break;
+
+        case root_parallel:
+            // until the trees are merged, no single tree knows how far ahead the best move is
+            controller.disable_early_stop();
+            for(int i=1; i < config.num_threads; i++) {
+                // the ensemble shares this tree's arena and expansion order so that
+                // merge_root() can adopt its nodes
+                ensemble.push_back(new MoveTree(*this->position, this->player, this->arena));
+                ensemble.back()->set_split_moves(this->split_moves);
+                ensemble.back()->expansion_offset = this->expansion_offset;
+                ensemble.back()->expansion_stride = this->expansion_stride;
+                helpers.push_back(std::thread(&MoveTree::search_worker<E>, ensemble.back(), &controller,
+                                              &evaluator, &policy, (uint64_t)fast_rand(), (LeafPool *)NULL,
+                                              false));
+            }
+            this->search_worker(&controller, &evaluator, &policy, (uint64_t)fast_rand(), NULL, true);
+            break;
+
+        case leaf_parallel: {
+            LeafPool leaf_pool(config.num_threads);
+            this->search_worker(&controller, &evaluator, &policy, (uint64_t)fast_rand(),
+                                config.num_threads > 1 ? &leaf_pool : NULL, true);
+            break;
+        }
+    }
+
+    for(std::thread& helper : helpers) {
+        helper.join();
+    }
+    for(MoveTree *tree : ensemble) {
+        this->merge_root(*tree);
+        delete tree;
+    }
+    if(config.monitor != NULL)
+        this->report_progress(controller);
+}
+
+/*
+ * The moves are evaluated using MCTS until config.limits run out, or
+ * until the best move is settled, with config.num_threads threads
+ * searching in config.parallel_mode, scoring leaves with config.evaluator
+ *
+ * Params:
+ *     config - the settings to search with
+ * Return: none
+ */
+void MoveTree::think(const ai_config_t& config) {
+    // the tables are kept from search to search, like the tree
+    if(config.transposition_bytes > 0 && this->transpositions == NULL) {
+        this->attach_tables(new TranspositionTable(config.transposition_bytes), this->eval_cache);
+        this->owns_transpositions = true;
+    }
+    if(config.eval_cache_bytes > 0 && this->eval_cache == NULL) {
+        this->attach_tables(this->transpositions, new EvalCache(config.eval_cache_bytes));
+        this->owns_eval_cache = true;
+    }
+
+    if(config.split_moves != this->split_moves)
+        this->set_split_moves(config.split_moves);
+
+    switch(config.evaluator.type) {
+        case territory_evaluator:
+            this->search(config, TerritoryEvaluator(config.evaluator.territory));
+            break;
+        case classic_evaluator:
+        default:
+            this->search(config, ClassicEvaluator(config.evaluator.classic));
+            break;
+    }
+}
+
+// rollout() is public, so it is instantiated for every evaluator
+template int MoveTree::rollout(Board& board, int depth, const ClassicEvaluator& evaluator,
+                               const SelectionPolicy& policy, LeafPool *leaf_pool);
+template int MoveTree::rollout(Board& board, int depth, const TerritoryEvaluator& evaluator,
+                               const SelectionPolicy& policy, LeafPool *leaf_pool);
+
+} // namespace BOARD_NAMESPACE
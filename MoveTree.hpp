@@ -2,27 +2,508 @@
 #define MOVETREE_H
 
 #include <stdlib.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
-#include <unordered_set>
 #include "amazons.hpp"
 #include "Board.hpp"
+#include "Endgame.hpp"
+#include "EvalState.hpp"
+#include "Evaluator.hpp"
+#include "NodeArena.hpp"
+#include "SearchController.hpp"
+#include "TranspositionTable.hpp"
+#include "EvalCache.hpp"
+#include "Selection.hpp"
+
+namespace BOARD_NAMESPACE {
 
-#define ROLLOUTS 10000
 #define SEARCH_DEPTH 20
+#define DECISION_CHECK_INTERVAL 64 // rollouts a thread does between checks whether the best move is settled
+#define VIRTUAL_LOSS 1 // rollouts a node is charged as losses while a thread is searching below it
+#define ENDGAME_UNCHECKED -1 // MoveTree::endgame before the endgame solver has looked at the node
+#define MOVES_UNCOUNTED -1 // MoveTree::num_moves before the node is first expanded
+// the unopened moves at the front of the expansion order that puct_policy
+// compares the priors of to pick the next child to open. At most 8
+#define PRIOR_CANDIDATES 4
+
+class MoveTree;
+
+/*
+ * A pool of threads that play out one leaf several times at once, for the
+ * leaf_parallel search mode. The thread asking for the playouts plays
+ * some of them too
+ */
+class LeafPool {
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+
+    // the evaluator of the current batch, behind a pointer to the function
+    // that calls it, so that the workers don't depend on its type
+    const void *evaluator;
+    int (*play_out)(MoveTree *leaf, const Board& board, int depth, const void *evaluator);
+    MoveTree *leaf; // the leaf of the current batch
+    const Board *board; // the leaf's position, which each playout copies
+    int depth; // the moves each playout of the batch plays
+    int *evals; // where the evaluation of each playout in the batch goes
+    int num_playouts;
+    std::atomic<int> next_playout; // the index of the next playout in the batch to claim
+    int busy_workers;
+    int batch_number; // incremented for each batch, so workers can tell a new one arrived
+    bool stopping;
+
+    // room for one batch, so that a batch allocates nothing
+    std::vector<int> batch_evals;
+
+    // plays playouts from the current batch until none are left to claim
+    void play_batch();
+
+    /*
+     * The loop run by each worker thread
+     *
+     * Params:
+     *     seed - the seed for the worker's random number generator
+     * Return: none
+     */
+    void work(uint64_t seed);
+
+    // the body of evaluate(), once the evaluator is set
+    void evaluate_batch(MoveTree *leaf, const Board& board, int depth, int *evals, int num_playouts);
+
+    public:
+    /*
+     * Starts num_threads - 1 worker threads
+     *
+     * Params:
+     *     num_threads - the number of threads (including the caller's) that play out each batch
+     */
+    explicit LeafPool(int num_threads);
+
+    // stops and joins the workers
+    ~LeafPool();
+
+    // the number of threads (including the caller's) that play out each batch
+    int size() {return this->workers.size() + 1;}
+
+    // room for size() evaluations, to gather a batch's results in
+    int *eval_buffer() {return this->batch_evals.data();}
+
+    /*
+     * Plays out a leaf num_playouts times, spreading the playouts over the
+     * pool. Returns once every playout has been evaluated
+     *
+     * Params:
+     *     leaf - the node to play out from
+     *     board - the leaf's position
+     *     depth - the moves to play in each playout
+     *     evals - filled with the evaluation of each playout
+     *     num_playouts - the length of evals
+     *     evaluator - the heuristic to evaluate the playouts with
+     * Return: none
+     */
+    template<class E>
+    void evaluate(MoveTree *leaf, const Board& board, int depth, int *evals, int num_playouts, const E& evaluator);
+};
 
 class MoveTree {
+    friend class LeafPool;
+
     MoveTree *parent;
-    move_t prev_move;
+    packed_move_t prev_move;
 
-    Board board;
+    // Nodes don't keep their positions. Only the root has one, and each
+    // rollout copies it once and makes and takes back the moves on the
+    // path it descends, so every function below the root is passed the
+    // node's position as board
+    Board *position; // the root's position, owned by it; NULL below the root
+    uint64_t key; // the key of this node's position, for the transposition table and eval cache
     player_t player;
+    // with split moves, a move is opened as two levels of the tree: a node
+    // for the amazon's move, whose children are the arrows she can shoot
+    bool split_moves;
+    bool arrow_pending; // this is the node of an amazon move; position and player are still the parent's
+    bool has_moves; // whether player has a move, known as soon as the node is made
+
+    NodeArena<MoveTree> *arena; // where this node's children are allocated
+    bool owns_arena; // true for a root which created its own arena
+
+    // in DAG mode, the statistics shared by every node with the same
+    // position, which node selection goes by. NULL for a plain tree
+    TranspositionTable *transpositions;
+    bool owns_transpositions; // true for a root which created the table
+    std::atomic<uint64_t> *shared_stats; // this position's entry in the table, or NULL
+
+    EvalCache *eval_cache; // the scores of leaves already evaluated, shared by the tree, or NULL
+    bool owns_eval_cache; // true for a root which created the cache
+
+    // the children form a list linked through next_sibling, newest first
+    MoveTree *first_child;
+    MoveTree *next_sibling;
+    int num_children;
+    // the number of moves (or amazon moves, or arrows) from the node, not the
+    // number of children. Most nodes are only ever played out from, so the
+    // moves are counted when a rollout first expands the node; until then,
+    // num_moves is MOVES_UNCOUNTED and has_moves is all that is known
+    int num_moves;
+    // each amazon's share of num_moves, lowest square first, so that
+    // nth_child_move() skips whole amazons without recounting them. Unused
+    // in a node whose arrow is pending
+    int16_t amazon_moves[AMAZONS_PER_PLAYER];
+
+    // children are opened in the order (expansion_offset + k * expansion_stride) % num_moves
+    // of the list board.get_moves() would return. The stride is coprime with
+    // num_moves, so the order visits every move once. Under uct_policy, the
+    // first num_children moves of that order are exactly the ones with
+    // children, and no set of opened moves is needed. Under puct_policy, the
+    // move with the best prior among the first PRIOR_CANDIDATES unopened ones
+    // is opened next, and bit j of opened_ahead is set if the move j places
+    // past the first unopened one has been opened out of turn
+    int expansion_offset;
+    int expansion_stride;
+    uint8_t opened_ahead;
+
+    std::atomic_flag expansion_lock; // guards the list of children
+
+    // updated without locks so that threads can back up results concurrently
+    std::atomic<int> num_wins;
+    std::atomic<int> num_rollouts;
+
+    float prior; // the weight puct_policy gives the move to this node, from SelectionPolicy::prior_weight()
+
+    // an endgame_verdict_t, once the node has been reached as a leaf and
+    // given to the endgame solver. A solved node is never searched below again
+    std::atomic<signed char> endgame;
+
+    /*
+     * Spinlock around this node's children. A thread only ever holds the lock
+     * of one node at a time (it is released before descending), so searching
+     * threads can't deadlock on each other
+     */
+    void lock() {
+        while(this->expansion_lock.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield(); // the holder may be waiting for a core
+    }
+    void unlock() {this->expansion_lock.clear(std::memory_order_release);}
+
+    /*
+     * Charges this node VIRTUAL_LOSS lost rollouts while a thread searches
+     * below it, so that other threads are steered towards other nodes.
+     * update_counters() takes the charge back off
+     */
+    void add_virtual_loss() {
+        this->num_rollouts.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+        if(this->shared_stats != NULL)
+            TranspositionTable::add(this->shared_stats, this->position_key(), 0, VIRTUAL_LOSS);
+    }
+
+    /*
+     * Reads the rollouts through this node and the wins among them for the
+     * player who made the move to it. In DAG mode these are the statistics
+     * of the position, from every node that reached it
+     *
+     * Params:
+     *     wins - set to the wins
+     *     rollouts - set to the rollouts
+     * Return: none
+     */
+    void read_stats(int *wins, int *rollouts) const {
+        if(this->shared_stats == NULL
+           || !TranspositionTable::read(this->shared_stats, this->position_key(), wins, rollouts)) {
+            *rollouts = this->num_rollouts.load(std::memory_order_relaxed);
+            *wins = this->num_wins.load(std::memory_order_relaxed);
+        }
+        if(*wins > *rollouts) // a result can land in the table without its virtual loss
+            *wins = *rollouts;
+    }
+
+    // the key of this node's position in the transposition table
+    uint64_t position_key() const {return this->key;}
+
+    // whether this node's children are amazon moves still waiting for their arrows
+    bool opens_amazon_moves() const {return this->split_moves && !this->arrow_pending;}
+
+    // whether a rollout that ended at eval was won by the player who made the move to this node
+    bool mover_won(int eval) const {
+        player_t mover = this->arrow_pending ? this->player : !this->player;
+        return first_better(mover, eval, 0);
+    }
+
+    /*
+     * Sets num_moves to the number of children this node can have: its
+     * player's legal moves, or with split moves, the amazon moves, or the
+     * arrows of the amazon move that led here. Fills amazon_moves, and picks
+     * the order the children are opened in
+     *
+     * Precondition: no other thread can see the node, or the caller holds its lock
+     *
+     * Params:
+     *     board - this node's position
+     * Return: none
+     */
+    void count_moves(Board& board);
+
+    // count_moves(), unless the moves have been counted already
+    void count_moves_once(Board& board) {
+        if(this->num_moves == MOVES_UNCOUNTED)
+            this->count_moves(board);
+    }
+
+    /*
+     * Finds the move for this node's nth child, in the order count_moves()
+     * counts them, without building a list of moves
+     *
+     * Precondition: 0 <= n < num_moves, which have been counted
+     *
+     * Params:
+     *     board - this node's position
+     *     n - the index of the move
+     * Return: a packed_move_t - the move. An amazon move has no arrow (arrow square 0)
+     */
+    packed_move_t nth_child_move(Board& board, int n) const;
+
+    // the squares the amazon of prev_move can shoot at on board, for a node whose arrow is pending
+    Bitboard arrow_squares(const Board& board) const;
+
+    /*
+     * Finds the child for a move made from this node. With split moves, a
+     * full move finds the node of its amazon move
+     *
+     * Params:
+     *     move - the move
+     * Return: the child, or NULL if it hasn't been opened
+     */
+    MoveTree *find_child(packed_move_t move) const;
+
+    /*
+     * Switches a root between opening full moves and split moves. Its
+     * children are dropped, since they are of the other kind; they stay in
+     * the arena until the tree is next trimmed
+     *
+     * Params:
+     *     split - whether to split moves
+     * Return: none
+     */
+    void set_split_moves(bool split);
+
+    /*
+     * Evaluates a position at the end of a rollout once the endgame solver
+     * has looked at it, and stores the evaluation in the cache, if there is
+     * one. The moves are only counted if the evaluator needs them, and the
+     * cache is only given the count if they were
+     *
+     * Params:
+     *     board - the position
+     *     player - the player to move
+     *     key - the position's key in the cache
+     *     verdict - what the endgame solver found
+     *     evaluator - the heuristic to use, if the solver couldn't decide
+     * Return: an int - the more positive, the better for left
+     */
+    template<class E>
+    int evaluate_leaf(Board& board, player_t player, uint64_t key, endgame_verdict_t verdict, const E& evaluator);
+
+    /*
+     * Scores this node's position at the end of a rollout: exactly, if the
+     * endgame solver can decide it, and with the heuristic otherwise
+     *
+     * Params:
+     *     board - this node's position
+     *     evaluator - the heuristic to use
+     * Return: an int - the more positive, the better for left
+     */
+    template<class E>
+    int score(Board& board, const E& evaluator);
+
+    /*
+     * The playout phase of a rollout: plays depth moves on a scratch copy
+     * of this node's position, picked by playout_move(), and scores the final
+     * position like score() does. None of the positions become nodes
+     *
+     * Params:
+     *     position - this node's position
+     *     depth - the moves to play
+     *     evaluator - the heuristic to score the final position with
+     * Return: an int - the more positive, the better for left
+     */
+    template<class E>
+    int playout(const Board& position, int depth, const E& evaluator);
+
+    // plays out a leaf for LeafPool, which sees the evaluator only as evaluator_ptr
+    template<class E>
+    static int play_out_leaf(MoveTree *leaf, const Board& board, int depth, const void *evaluator_ptr) {
+        return leaf->playout(board, depth, *static_cast<const E *>(evaluator_ptr));
+    }
+
+    /*
+     * Records the result of a rollout in this node and every node above it,
+     * without touching virtual losses. Used for the extra results of a
+     * leaf_parallel batch, which don't travel back up the recursion
+     *
+     * Params:
+     *     eval - the evaluation of the final position of a rollout
+     * Return: none
+     */
+    void back_up(int eval);
+
+    /*
+     * Picks the child to continue a rollout from (opening a new one if the
+     * policy allows another) while holding this node's lock, and charges it
+     * a virtual loss before letting other threads in
+     *
+     * Params:
+     *     board - this node's position
+     *     policy - the rule to select by
+     * Return: the child to descend into
+     */
+    MoveTree *select_child(Board& board, const SelectionPolicy& policy);
+
+    /*
+     * The playout phase of a leaf_parallel rollout: plays this leaf out
+     * once per pool thread, all at once, and backs every result up the tree
+     *
+     * Params:
+     *     board - this node's position
+     *     depth - the moves to play in each playout
+     *     evaluator - the heuristic to score the playouts with
+     *     leaf_pool - the threads to play out with
+     * Return: an int - the evaluation of the first playout, which is backed
+     *         up through the rollout recursion like a normal result
+     */
+    template<class E>
+    int playout_leaves(const Board& board, int depth, const E& evaluator, LeafPool *leaf_pool);
+
+    /*
+     * The loop run by each searching thread: does rollouts from this node
+     * until the controller ends the search
+     *
+     * Params:
+     *     controller - decides when the search is over, shared by all threads
+     *     evaluator - the heuristic to evaluate leaves with
+     *     policy - the rule to descend the tree by
+     *     seed - the seed for this thread's random number generator
+     *     leaf_pool - the threads to play leaves out with, or NULL outside leaf_parallel mode
+     *     reports - whether this thread reports the search's progress to the
+     *               controller's monitor. True for one thread only
+     * Return: none
+     */
+    template<class E>
+    void search_worker(SearchController *controller, const E *evaluator, const SelectionPolicy *policy,
+                       uint64_t seed, LeafPool *leaf_pool, bool reports);
+
+    /*
+     * Reports the move best_child() would pick so far, and the share of
+     * its rollouts won, to the controller's monitor. Safe to call while
+     * other threads search the tree
+     *
+     * Params:
+     *     controller - the controller of the running search
+     * Return: none
+     */
+    void report_progress(const SearchController& controller);
+
+    /*
+     * The body of think(), once the evaluator is picked. Every function the
+     * search calls per rollout is instantiated for E, so the evaluation is
+     * a direct call
+     *
+     * Params:
+     *     config - the settings to search with
+     *     evaluator - the heuristic to evaluate leaves with
+     * Return: none
+     */
+    template<class E>
+    void search(const ai_config_t& config, const E& evaluator);
+
+    /*
+     * Determines whether the move best_child() would pick is settled: no
+     * other child could catch up with its wins in the results still to come
+     *
+     * Params:
+     *     results_left - the most rollout results the search can still back up
+     * Return: a bool - true if more searching can't change the move picked
+     */
+    bool best_move_decided(long results_left);
+
+    /*
+     * Merges the results of another search of the same position into this
+     * one, for root_parallel mode. Root children for the same move have their
+     * counts added together; root children this tree lacks are moved over.
+     * Leaves other with no children
+     *
+     * Precondition: other shares this tree's arena and expansion order
+     *
+     * Params:
+     *     other - a tree with the same board and player as this one
+     * Return: none
+     */
+    void merge_root(MoveTree& other);
+
+    // picks a random order in which to open this node's children
+    void choose_expansion_order();
+
+    // the index, for nth_child_move(), of the kth move in the expansion order
+    int expansion_index(int k) const {
+        return (this->expansion_offset + (long long)k * this->expansion_stride) % this->num_moves;
+    }
+
+    /*
+     * For puct_policy: picks the unopened move with the best prior among
+     * the first PRIOR_CANDIDATES of the expansion order, and marks it opened.
+     * The candidates' mobility is counted together, with one call to
+     * classic_child_terms()
+     *
+     * Params:
+     *     board - this node's position, left as it was
+     *     mobility_gain - set to the picked move's mobility gain, for its prior
+     * Return: the move to open
+     */
+    packed_move_t pick_prior_candidate(Board& board, int *mobility_gain);
 
-    std::vector<MoveTree *> children;
-    int num_moves; // the number of legal moves from the position, not the size of the vector
-    std::unordered_set<int> child_indices; // the indices of the elts of this->children in this->board.get_moves()
+    /*
+     * Has this node and everything below it use the passed tables
+     *
+     * Params:
+     *     transpositions - the transposition table to share statistics through, or NULL
+     *     eval_cache - the cache of leaf scores to use, or NULL
+     * Return: none
+     */
+    void attach_tables(TranspositionTable *transpositions, EvalCache *eval_cache);
+
+    /*
+     * Copies the position, statistics and expansion state of another node
+     * into this one. Leaves the links to other nodes alone
+     *
+     * Params:
+     *     original - the node to copy from
+     * Return: none
+     */
+    void copy_node_fields(const MoveTree& original);
+
+    /*
+     * Copies the children of another node, and everything below them, into
+     * this node's arena as children of this node
+     *
+     * Params:
+     *     original - the node whose descendants to copy
+     * Return: none
+     */
+    void copy_children(const MoveTree& original);
+
+    /*
+     * Constructor used to copy a node into another arena when the tree is
+     * trimmed. Copies everything but the links to other nodes
+     *
+     * Params:
+     *     original - the node to copy
+     *     parent - the parent of the copy
+     */
+    MoveTree(const MoveTree& original, MoveTree *parent);
 
-    int num_wins;
-    int num_rollouts;
+    friend class NodeArena<MoveTree>;
 
     public:
     /*
@@ -31,8 +512,10 @@ class MoveTree {
      * Params:
      *     board - the board state of the tree
      *     player - whose turn it is to move
+     *     arena - the arena to allocate nodes from. If NULL, the tree creates
+     *             (and later frees) its own
      */
-    MoveTree(Board board, player_t player);
+    MoveTree(Board board, player_t player, NodeArena<MoveTree> *arena = NULL);
 
     /*
      * This is the constructor used within the class to create children
@@ -40,17 +523,41 @@ class MoveTree {
      * Params:
      *     parent - a pointer to the parent node
      *     move - the move which transposes the parent's board to this one's
-     *     index - the index of this tree in the parent's chilren array
+     *     board - the new node's position: the parent's with the move made, or
+     *             the parent's as it is if the move is an amazon move
      */
-    MoveTree(MoveTree *parent, move_t move);
+    MoveTree(MoveTree *parent, packed_move_t move, Board& board);
 
     /*
      * MoveTree destructor
-     * Recursively destroys children too
+     * Nodes live in the arena and are never destroyed one at a time, so
+     * freeing the whole tree is just freeing the arena (if this tree owns it)
      */
     ~MoveTree();
 
-    move_t get_prev_move() {return this->prev_move;}
+    packed_move_t get_prev_move() {return this->prev_move;}
+
+    // the table the tree shares statistics through, or NULL if it is a plain tree
+    const TranspositionTable *get_transpositions() const {return this->transpositions;}
+
+    // the cache of leaf scores the tree uses, or NULL if it has none
+    const EvalCache *get_eval_cache() const {return this->eval_cache;}
+
+    /*
+     * Follows a move made in the game: the child for that move becomes the
+     * root, keeping its statistics and subtree, and the rest of the tree is
+     * freed. If the move has no child yet, the tree starts over from the new
+     * position. Called after every move, by either player, so that the tree
+     * always matches the game board
+     *
+     * Precondition: this is the root of a tree which owns its arena, and no
+     *               search is running on it
+     *
+     * Params:
+     *     move - the move made from this tree's position
+     * Return: none
+     */
+    void advance(packed_move_t move);
 
     /*
      * Updates this node's counts according to the result of this rollout
@@ -66,59 +573,100 @@ class MoveTree {
      * Favorability, or "promise", is a combination of how strong the move to
      * this position is, and how unexplored this node is
      *
-     * Params: none
+     * Params:
+     *     policy - the rule to score by
+     *     parent_term - policy.parent_term() of the parent's visits
      * Return: a float - the higher, the more promising this node is
      */
-    inline float promise();
+    inline float promise(const SelectionPolicy& policy, float parent_term);
 
     /*
-     * Returns the index in the children list of the node which should continue 
-     * the rollout, as calculated by the promise() method
+     * Returns the child which should continue the rollout, as calculated by 
+     * the promise() method
      * If there's a tie, randomly selects one of the tied best children
      *
-     * Params: none
-     * Return: an int - the index of the most lucrative continuation
+     * Precondition: this node has children
+     *
+     * Params:
+     *     policy - the rule to score the children by
+     * Return: a pointer to the most lucrative continuation
      */
-    int most_promising_index(float floor);
+    MoveTree *most_promising_child(const SelectionPolicy& policy);
 
     /*
-     * Constructs a child node, randomly selected from the moves from this position
-     * for which we haven't yet constructed a child. Also adds the index in of it
-     * (in the list returned from this->board.get_moves()) to the child_indices set
+     * Constructs a child node for the next move in this node's expansion
+     * order, or under puct_policy for the best prior of the next few. The
+     * move is looked up with nth_child_move(), so the list is never built.
+     * The move is made on board for the child and taken back after
      *
-     * Params: none
-     * Return: none
+     * Params:
+     *     board - this node's position
+     *     policy - the rule the child will be selected by, which may want its prior
+     * Return: a pointer to the new child
      */
-    void open_new_node();
+    MoveTree *open_new_node(Board& board, const SelectionPolicy& policy);
 
     /*
      * Simulates a semirandom continuation of the game. Updates the counters
      * of the positions reached in this simulation based on whether the end 
-     * result was good or bad for the player whose turn it was in that position
+     * result was good or bad for the player whose turn it was in that position.
+     * The tree is descended to the first node the simulation reaches for the
+     * first time, and the rest of the moves are played out from there, so
+     * each rollout adds one node to the tree
      *
      * Params:
+     *     board - this node's position. The moves made on it on the way
+     *             down are taken back on the way up
      *     depth - the number of moves to simulate before evaluating the position
+     *     evaluator - the heuristic to evaluate the final position with
+     *     policy - the rule to descend the tree by
+     *     leaf_pool - the threads to play leaves out with, or NULL outside leaf_parallel mode
      * Return: an int - the evaluation of the final position of the simulation
      */
-    int rollout(int depth);
+    template<class E>
+    int rollout(Board& board, int depth, const E& evaluator, const SelectionPolicy& policy, LeafPool *leaf_pool);
 
     /*
      * Finds the best move in the position based on the results of MCTS
      *
      * Params: none
-     * Returns: an int - the index of the best move in the children list
+     * Returns: a pointer to the child the best move leads to
      */
-    int best_move_index();
+    MoveTree *best_child();
 
     /*
-     * A few seconds are spent evaluating the moves using MCTS
+     * The moves are evaluated using MCTS until config.limits run out, or
+     * until the best move is settled, with config.num_threads threads
+     * searching in config.parallel_mode, scoring leaves with config.evaluator
      *
-     * Params: none
+     * Params:
+     *     config - the settings to search with
      * Return: none
      */
-    void think();
+    void think(const ai_config_t& config);
 
-    move_t make_move(Board& board);
+    /*
+     * The AI searches the position and makes its move on board. The tree is
+     * not trimmed; call advance() with the move afterwards. If the endgame
+     * solver can pick the move, there is no search
+     *
+     * Params: 
+     *     board - the main game board on which the AI will move
+     *     config - the settings to search with
+     * Returns: the move the AI made
+     */
+    move_t make_move(Board& board, const ai_config_t& config);
 };
 
-#endif
\ No newline at end of file
+// defined once MoveTree is complete, since it names MoveTree::play_out_leaf
+template<class E>
+void LeafPool::evaluate(MoveTree *leaf, const Board& board, int depth, int *evals, int num_playouts,
+                        const E& evaluator) {
+    this->evaluator = &evaluator;
+    this->play_out = &MoveTree::play_out_leaf<E>;
+    this->evaluate_batch(leaf, board, depth, evals, num_playouts);
+}
+
+} // namespace BOARD_NAMESPACE
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef NODEARENA_H
+#define NODEARENA_H
+
+// A bump allocator for search tree nodes. Nodes are carved out of large
+// slabs and never freed one at a time; the whole arena is reset (or deleted)
+// at once when the search it belongs to is over
+
+#include <stdlib.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#define SLAB_BITS 14
+#define SLAB_NODES (1 << SLAB_BITS) // nodes per slab
+#define MAX_SLABS 4096 // caps an arena at 2^26 nodes
+
+template<class T>
+class NodeArena {
+    std::atomic<T *> slabs[MAX_SLABS]; // slabs are allocated on first use and kept across resets
+    std::atomic<size_t> next_node; // the index of the next unused node, counting across slabs
+    std::mutex slab_mutex; // only taken when a new slab has to be allocated
+
+    public:
+    NodeArena() {
+        for(int i=0; i < MAX_SLABS; i++)
+            this->slabs[i] = NULL;
+        this->next_node = 0;
+    }
+
+    ~NodeArena() {
+        for(int i=0; i < MAX_SLABS; i++)
+            free(this->slabs[i].load());
+    }
+
+    /*
+     * Constructs a node in the arena. Safe to call from several threads at once.
+     * The node's destructor is never run, so T must not own any other memory
+     *
+     * Params:
+     *     args - the arguments to pass to T's constructor
+     * Return: a pointer to the new node, valid until the arena is reset
+     */
+    template<class... Args>
+    T *allocate(Args&&... args) {
+        size_t index = this->next_node.fetch_add(1, std::memory_order_relaxed);
+        size_t slab_index = index >> SLAB_BITS;
+        if(slab_index >= MAX_SLABS)
+            throw std::bad_alloc();
+
+        T *slab = this->slabs[slab_index].load(std::memory_order_acquire);
+        if(slab == NULL) {
+            std::lock_guard<std::mutex> guard(this->slab_mutex);
+            slab = this->slabs[slab_index].load(std::memory_order_relaxed);
+            if(slab == NULL) {
+                slab = (T *)malloc(sizeof(T) * SLAB_NODES);
+                if(slab == NULL)
+                    throw std::bad_alloc();
+                this->slabs[slab_index].store(slab, std::memory_order_release);
+            }
+        }
+        return new (&slab[index & (SLAB_NODES - 1)]) T(std::forward<Args>(args)...);
+    }
+
+    // forgets every node in the arena at once. Keeps the slabs for reuse
+    void reset() {this->next_node = 0;}
+
+    // the number of nodes allocated since the last reset
+    size_t size() const {return this->next_node.load(std::memory_order_relaxed);}
+
+    // the number of bytes the allocated nodes take up
+    size_t bytes() const {return this->size() * sizeof(T);}
+};
+
+#endif
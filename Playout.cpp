@@ -0,0 +1,118 @@
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+#include "Playout.hpp"
+
+namespace BOARD_NAMESPACE {
+
+/*
+ * The prior of a move: the empty squares next to the amazon's destination
+ * once she and her arrow are placed, plus PLAYOUT_ARROW_BONUS if the arrow
+ * lands next to an amazon of the opponent
+ *
+ * Params:
+ *     empty - the empty squares before the move
+ *     opponent_neighbours - the squares next to the opponent's amazons
+ *     move - the move
+ * Return: an int - the higher, the more promising the move
+ */
+static inline int move_prior(const Bitboard& empty, const Bitboard& opponent_neighbours, packed_move_t move) {
+    Bitboard after = empty;
+    after.set(move_old_loc(move));
+    after.reset(move_new_loc(move));
+    after.reset(move_arrow(move));
+
+    int room = (Bitboard::king_dilation(Bitboard::square(move_new_loc(move))) & after).count();
+    return room + (opponent_neighbours[move_arrow(move)] ? PLAYOUT_ARROW_BONUS : 0);
+}
+
+/*
+ * Picks a random arrow for an amazon that has moved from old_loc to new_loc
+ *
+ * Params:
+ *     empty - the empty squares before the amazon moved
+ *     old_loc - the square she moved from
+ *     new_loc - the square she moved to
+ * Return: a packed_move_t - the full move
+ */
+static inline packed_move_t random_arrow(Bitboard empty, int old_loc, int new_loc) {
+    empty.set(old_loc); // she can shoot back through the square she left
+    Bitboard arrows = Bitboard::queen_attacks(Bitboard::square(new_loc), empty);
+    return pack_move(old_loc, new_loc, arrows.nth_set(fast_rand() % arrows.count()));
+}
+
+/*
+ * Picks a move for a player in a playout: samples PLAYOUT_CANDIDATES moves
+ * and returns the one with the best prior. An amazon is sampled uniformly
+ * from those that can move, then her destination, then her arrow
+ *
+ * Params:
+ *     board - the position
+ *     player - the player to move
+ * Return: a packed_move_t - a legal move, or NO_MOVE if player has none
+ */
+packed_move_t playout_move(const Board& board, player_t player) {
+    Bitboard empty = ~board.get_occupied();
+    Bitboard amazons = board.get_amazons(player);
+    int squares[AMAZONS_PER_PLAYER];
+    Bitboard destinations[AMAZONS_PER_PLAYER];
+    int num_mobile = 0;
+
+    while(amazons.any()) {
+        int square = amazons.pop_lowest();
+        Bitboard reach = Bitboard::queen_attacks(Bitboard::square(square), empty);
+        if(reach.any()) {
+            squares[num_mobile] = square;
+            destinations[num_mobile++] = reach;
+        }
+    }
+    if(num_mobile == 0)
+        return NO_MOVE;
+
+    Bitboard opponent_neighbours = Bitboard::king_dilation(board.get_amazons(!player));
+    packed_move_t best_move = NO_MOVE;
+    int best_prior = -1;
+    for(int i=0; i < PLAYOUT_CANDIDATES; i++) {
+        int amazon = fast_rand() % num_mobile;
+        int new_loc = destinations[amazon].nth_set(fast_rand() % destinations[amazon].count());
+        packed_move_t move = random_arrow(empty, squares[amazon], new_loc);
+
+        int prior = move_prior(empty, opponent_neighbours, move);
+        if(prior > best_prior) {
+            best_prior = prior;
+            best_move = move;
+        }
+    }
+    return best_move;
+}
+
+/*
+ * Picks an arrow for an amazon move whose arrow is still to be shot, the
+ * same way playout_move() picks arrows
+ *
+ * Precondition: the amazon move is legal, so she always has an arrow to shoot
+ *
+ * Params:
+ *     board - the position before the amazon moved
+ *     player - the player moving
+ *     amazon_move - the amazon move, with no arrow
+ * Return: a packed_move_t - the full move, with its arrow
+ */
+packed_move_t playout_arrow(const Board& board, player_t player, packed_move_t amazon_move) {
+    Bitboard empty = ~board.get_occupied();
+    Bitboard opponent_neighbours = Bitboard::king_dilation(board.get_amazons(!player));
+    packed_move_t best_move = NO_MOVE;
+    int best_prior = -1;
+
+    for(int i=0; i < PLAYOUT_CANDIDATES; i++) {
+        packed_move_t move = random_arrow(empty, move_old_loc(amazon_move), move_new_loc(amazon_move));
+        int prior = move_prior(empty, opponent_neighbours, move);
+        if(prior > best_prior) {
+            best_prior = prior;
+            best_move = move;
+        }
+    }
+    return best_move;
+}
+
+} // namespace BOARD_NAMESPACE
@@ -0,0 +1,49 @@
+#ifndef PLAYOUT_H
+#define PLAYOUT_H
+
+// The move picker for the playout phase of MCTS: the moves played on a
+// scratch board below the leaf a rollout adds to the tree, which never
+// become nodes. A few moves are sampled cheaply from the queen attacks of
+// the amazons, and the one with the best prior is played. A move's prior
+// favours arrows next to an opponent's amazon, which take away her room,
+// and destinations with empty squares around them, which keep the mover's
+// own room. No move list is built and nothing is allocated
+
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define PLAYOUT_CANDIDATES 3 // moves sampled at each step of a playout, of which the best prior is played
+#define PLAYOUT_ARROW_BONUS 4 // prior points for an arrow next to an amazon of the opponent
+
+/*
+ * Picks a move for a player in a playout: samples PLAYOUT_CANDIDATES moves
+ * and returns the one with the best prior. An amazon is sampled uniformly
+ * from those that can move, then her destination, then her arrow
+ *
+ * Params:
+ *     board - the position
+ *     player - the player to move
+ * Return: a packed_move_t - a legal move, or NO_MOVE if player has none
+ */
+packed_move_t playout_move(const Board& board, player_t player);
+
+/*
+ * Picks an arrow for an amazon move whose arrow is still to be shot, the
+ * same way playout_move() picks arrows
+ *
+ * Precondition: the amazon move is legal, so she always has an arrow to shoot
+ *
+ * Params:
+ *     board - the position before the amazon moved
+ *     player - the player moving
+ *     amazon_move - the amazon move, with no arrow
+ * Return: a packed_move_t - the full move, with its arrow
+ */
+packed_move_t playout_arrow(const Board& board, player_t player, packed_move_t amazon_move);
+
+} // namespace BOARD_NAMESPACE
+
+#endif
@@ -0,0 +1,321 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include "amazons.hpp"
+#include "AlphaBeta.hpp"
+#include "Board.hpp"
+#include "MoveTree.hpp"
+#include "Protocol.hpp"
+#include "SearchController.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define PROTOCOL_SEPARATORS " \t\r\n"
+#define MOVE_TEXT_LENGTH 16 // enough for the longest move, j10-j10/j10, and its terminator
+#define REPORT_INTERVAL 1.0 // seconds between info lines during an MCTS search
+#define INFINITE_ROLLOUTS (1L << 40) // the rollout limit of go infinite, which only stop or memory ends
+
+/*
+ * Writes a move as from-to/arrow, such as d1-d7/g7
+ *
+ * Params:
+ *     move - the move to write
+ *     text - filled with the move, at least MOVE_TEXT_LENGTH chars
+ * Return: none
+ */
+static void format_move(packed_move_t move, char *text) {
+    int squares[3] = {move_old_loc(move), move_new_loc(move), move_arrow(move)};
+    int columns[3];
+    int rows[3];
+
+    for(int i=0; i < 3; i++) {
+        columns[i] = 'a' + squares[i] % BBWIDTH - 1;
+        rows[i] = BOARDWIDTH + 1 - squares[i] / BBWIDTH; // flipping from 1=top to 1=bottom
+    }
+    snprintf(text, MOVE_TEXT_LENGTH, "%c%d-%c%d/%c%d",
+             columns[0], rows[0], columns[1], rows[1], columns[2], rows[2]);
+}
+
+/*
+ * Reads one square of a move, such as d7
+ *
+ * Params:
+ *     text - the text to read from
+ *     end - set to the first char after the square
+ * Return: the square's bitboard index, or -1 if text doesn't start with a square
+ */
+static int parse_square(const char *text, const char **end) {
+    int column = tolower(text[0]) - 'a' + 1;
+    char *row_end;
+
+    if(column < 1 || column > BOARDWIDTH || !isdigit(text[1]))
+        return -1;
+    long row = strtol(text + 1, &row_end, 10);
+    if(row < 1 || row > BOARDWIDTH)
+        return -1;
+    *end = row_end;
+    return (BOARDWIDTH + 1 - row) * BBWIDTH + column;
+}
+
+/*
+ * Reads a move written from-to/arrow
+ *
+ * Params:
+ *     text - the move
+ * Return: the move, or NO_MOVE if text isn't one. It may still be illegal
+ */
+static packed_move_t parse_move(const char *text) {
+    const char *end = text;
+    int old_loc = parse_square(end, &end);
+    if(old_loc < 0 || *end != '-')
+        return NO_MOVE;
+    int new_loc = parse_square(end + 1, &end);
+    if(new_loc < 0 || *end != '/')
+        return NO_MOVE;
+    int arrow = parse_square(end + 1, &end);
+    if(arrow < 0 || *end != '\0')
+        return NO_MOVE;
+    return pack_move(old_loc, new_loc, arrow);
+}
+
+// writes a search's progress as an info line. Called from the searching thread
+static void print_info(const search_info_t& info) {
+    char move[MOVE_TEXT_LENGTH] = "none";
+
+    if(info.best_move != NO_MOVE)
+        format_move(info.best_move, move);
+    if(info.depth > 0)
+        printf("info time %.2f depth %d nodes %ld score %d move %s\n",
+               info.elapsed, info.depth, info.nodes, info.score, move);
+    else
+        printf("info time %.2f rollouts %ld winrate %.3f move %s\n",
+               info.elapsed, info.nodes, info.win_rate, move);
+}
+
+/*
+ * The game the protocol is driving, and the engines searching it
+ */
+class HeadlessEngine {
+    ai_config_t config;
+    SearchMonitor monitor;
+    Board board;
+    player_t player; // the player to move
+    MoveTree *tree; // MCTS's tree, rooted at board, or NULL until MCTS is first used
+    AlphaBeta *searcher; // NULL until alpha-beta is first used
+    std::thread search_thread; // the current search, joinable until waited for
+
+    /*
+     * Waits until the current search, if there is one, has written its bestmove
+     *
+     * Params:
+     *     stop - whether to end the search early rather than let it run to its limits
+     * Return: none
+     */
+    void wait_for_search(bool stop) {
+        if(this->search_thread.joinable()) {
+            if(stop)
+                this->monitor.request_stop();
+            this->search_thread.join();
+        }
+    }
+
+    /*
+     * The body of the searching thread: searches board and writes the
+     * bestmove. The move is made on a copy, so board is left as it is
+     *
+     * Params:
+     *     config - the settings to search with
+     *     seed - the seed for this thread's random number generator
+     * Return: none
+     */
+    void search(ai_config_t config, uint64_t seed) {
+        Board scratch = this->board;
+        char text[MOVE_TEXT_LENGTH];
+        move_t move;
+
+        seed_fast_rand(seed);
+        if(config.engine[this->player] == alphabeta_engine)
+            move = this->searcher->make_move(scratch, this->player, config);
+        else
+            move = this->tree->make_move(scratch, config);
+        format_move(pack_move(move), text);
+        printf("bestmove %s\n", text);
+    }
+
+    /*
+     * Makes each move in the rest of a command, in order, until one is
+     * not a legal move
+     *
+     * Params:
+     *     save - the strtok_r() state of the command, at the first move
+     * Return: none
+     */
+    void make_moves(char **save) {
+        char *token;
+
+        while((token = strtok_r(NULL, PROTOCOL_SEPARATORS, save)) != NULL) {
+            packed_move_t move = parse_move(token);
+            if(move == NO_MOVE || !this->board.make_move(this->player, move)) {
+                printf("error illegal move %s\n", token);
+                return;
+            }
+            if(this->tree != NULL)
+                this->tree->advance(move);
+            this->player = !this->player;
+        }
+    }
+
+    /*
+     * Starts a search of board, within the limits in the rest of a go
+     * command, in the background
+     *
+     * Params:
+     *     save - the strtok_r() state of the command, after go
+     * Return: none
+     */
+    void go(char **save) {
+        ai_config_t config = this->config;
+        search_limits_t& limits = config.limits;
+        bool limited = false;
+        char *key;
+
+        // limits given replace all of the command line's, except the memory cap
+        while((key = strtok_r(NULL, PROTOCOL_SEPARATORS, save)) != NULL) {
+            if(!limited) {
+                limits.move_time = limits.clock = limits.increment = 0;
+                limits.max_rollouts = 0;
+                limits.max_depth = 0;
+                limited = true;
+            }
+            if(strcmp(key, "infinite") == 0) {
+                limits.max_rollouts = INFINITE_ROLLOUTS;
+                limits.max_depth = AB_MAX_PLY;
+                continue;
+            }
+            char *value = strtok_r(NULL, PROTOCOL_SEPARATORS, save);
+            if(value == NULL) {
+                printf("error go %s needs a value\n", key);
+                return;
+            }
+            if(strcmp(key, "movetime") == 0)
+                limits.move_time = atof(value);
+            else if(strcmp(key, "clock") == 0)
+                limits.clock = atof(value);
+            else if(strcmp(key, "inc") == 0)
+                limits.increment = atof(value);
+            else if(strcmp(key, "rollouts") == 0)
+                limits.max_rollouts = atol(value);
+            else if(strcmp(key, "depth") == 0)
+                limits.max_depth = atoi(value);
+            else {
+                printf("error unknown go limit %s\n", key);
+                return;
+            }
+        }
+
+        if(this->board.no_moves(this->player)) {
+            printf("bestmove none\n");
+            return;
+        }
+        if(config.engine[this->player] == alphabeta_engine && this->searcher == NULL)
+            this->searcher = new AlphaBeta();
+        if(config.engine[this->player] == mcts_engine && this->tree == NULL)
+            this->tree = new MoveTree(this->board, this->player);
+
+        this->monitor.reset();
+        this->search_thread = std::thread(&HeadlessEngine::search, this, config, (uint64_t)fast_rand());
+    }
+
+    public:
+    explicit HeadlessEngine(const ai_config_t& config) : monitor(print_info, REPORT_INTERVAL) {
+        this->config = config;
+        this->config.monitor = &this->monitor;
+        this->player = LEFT;
+        this->tree = NULL;
+        this->searcher = NULL;
+    }
+
+    ~HeadlessEngine() {
+        this->wait_for_search(true);
+        delete this->tree;
+        delete this->searcher;
+    }
+
+    /*
+     * Carries out one command
+     *
+     * Params:
+     *     line - the command, which is cut up into tokens
+     * Return: a bool - false if the command was quit
+     */
+    bool execute(char *line) {
+        char *save;
+        char *command = strtok_r(line, PROTOCOL_SEPARATORS, &save);
+
+        if(command == NULL)
+            return true;
+        if(strcmp(command, "isready") == 0) {
+            printf("readyok\n");
+            return true;
+        }
+
+        // every other command needs the search over first
+        bool stop = strcmp(command, "stop") == 0 || strcmp(command, "quit") == 0;
+        this->wait_for_search(stop);
+
+        if(strcmp(command, "quit") == 0) {
+            return false;
+        } else if(strcmp(command, "stop") == 0) {
+            return true;
+        } else if(strcmp(command, "position") == 0) {
+            char *from = strtok_r(NULL, PROTOCOL_SEPARATORS, &save);
+            if(from == NULL || strcmp(from, "startpos") != 0) {
+                printf("error position needs startpos\n");
+                return true;
+            }
+            this->board = Board();
+            this->player = LEFT;
+            delete this->tree;
+            this->tree = NULL;
+            char *moves = strtok_r(NULL, PROTOCOL_SEPARATORS, &save);
+            if(moves != NULL && strcmp(moves, "moves") == 0)
+                this->make_moves(&save);
+            else if(moves != NULL)
+                printf("error unexpected %s\n", moves);
+        } else if(strcmp(command, "moves") == 0) {
+            this->make_moves(&save);
+        } else if(strcmp(command, "go") == 0) {
+            this->go(&save);
+        } else {
+            printf("error unknown command %s\n", command);
+        }
+        return true;
+    }
+};
+
+/*
+ * Runs the headless protocol until quit or the end of stdin
+ *
+ * Params:
+ *     config - the settings to search with, from the command line
+ * Return: the exit status
+ */
+int run_protocol(ai_config_t config) {
+    HeadlessEngine engine(config);
+    char *line = NULL;
+    size_t capacity = 0;
+
+    // replies go out as soon as they are written, even into a pipe
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    while(getline(&line, &capacity, stdin) >= 0) {
+        if(!engine.execute(line))
+            break;
+    }
+    free(line);
+    return 0;
+}
+
+} // namespace BOARD_NAMESPACE
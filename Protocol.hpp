@@ -0,0 +1,45 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+// A headless text protocol for driving the AI from another program, such
+// as a match harness, in the spirit of UCI and GTP. Commands are read from
+// stdin, one per line, and answered on stdout, one line per reply, with
+// nothing else printed. Moves are written from-to/arrow, such as d1-d7/g7,
+// with columns as letters and rows numbered from the bottom, as on the
+// board the game prints
+//
+//     position startpos [moves m...]  starts over from the opening position,
+//                                     then makes the moves
+//     moves m...                      makes the moves in the current position
+//     go [movetime s] [clock s] [inc s] [rollouts n] [depth n] [infinite]
+//                                     searches for the player to move. Limits
+//                                     given replace the command line's
+//     stop                            ends the search early
+//     isready                         answers readyok
+//     quit                            exits
+//
+// A search runs in the background, so stop and isready are answered while
+// it does. quit stops it too, and any other command waits for it to reach
+// its limits first. It reports on its progress with lines of the form
+//     info time s rollouts n winrate w move m       (MCTS, every second)
+//     info time s depth d nodes n score x move m    (alpha-beta, every depth)
+// and ends with "bestmove m", or "bestmove none" if the player to move has
+// no moves. The move isn't made; send it back with moves. A bad command is
+// answered with "error" and the reason
+
+#include "amazons.hpp"
+
+namespace BOARD_NAMESPACE {
+
+/*
+ * Runs the headless protocol until quit or the end of stdin
+ *
+ * Params:
+ *     config - the settings to search with, from the command line
+ * Return: the exit status
+ */
+int run_protocol(ai_config_t config);
+
+} // namespace BOARD_NAMESPACE
+
+#endif
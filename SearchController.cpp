@@ -0,0 +1,137 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include "amazons.hpp"
+#include "SearchController.hpp"
+
+namespace BOARD_NAMESPACE {
+
+/*
+ * Starts the clock on a search
+ *
+ * Params:
+ *     limits - the limits to search within
+ *     empty_squares - the number of empty squares on the board, used to
+ *                     guess how many moves the game clock has to last
+ *     monitor - what to report the search's progress to and take stop
+ *               requests from, or NULL
+ */
+SearchController::SearchController(const search_limits_t& limits, int empty_squares, SearchMonitor *monitor) {
+    this->start_time = std::chrono::steady_clock::now();
+    this->time_budget = limits.move_time;
+    this->max_rollouts = limits.max_rollouts;
+    this->max_memory = limits.max_memory;
+    this->early_stop = true;
+    this->rollouts_started = 0;
+    this->stopped = false;
+    this->monitor = monitor;
+    this->next_report = (monitor != NULL) ? monitor->report_interval : 0;
+
+    if(limits.clock > 0) {
+        // each move burns a square, so a player has at most half the empty
+        // squares' worth of moves left. Games are usually decided well before
+        // the board fills up, so the clock is spread over half of that
+        int moves_to_go = std::max(MIN_MOVES_TO_GO, empty_squares / 4);
+        double allotted = std::min(limits.clock / moves_to_go + limits.increment,
+                                   limits.clock * MAX_CLOCK_FRACTION);
+        if(this->time_budget <= 0 || allotted < this->time_budget)
+            this->time_budget = allotted;
+    }
+
+    if(this->time_budget <= 0 && this->max_rollouts <= 0)
+        this->max_rollouts = ROLLOUTS; // the search has to end somehow
+}
+
+/*
+ * Called by a searching thread before each rollout. Counts the rollout
+ * if it is allowed. The first rollout is always allowed, so that the
+ * search has a move to pick
+ *
+ * Params:
+ *     memory_used - the number of bytes the search tree takes up
+ * Return: a bool - true if the rollout may go ahead, false if the search is over
+ */
+bool SearchController::start_rollout(size_t memory_used) {
+    if(this->stopped.load(std::memory_order_relaxed))
+        return false;
+    long started = this->rollouts_started.fetch_add(1, std::memory_order_relaxed);
+    if(started == 0)
+        return true;
+
+    if((this->max_rollouts > 0 && started >= this->max_rollouts)
+       || (this->max_memory > 0 && memory_used >= this->max_memory)
+       || (this->time_budget > 0 && this->elapsed() >= this->time_budget)
+       || (this->monitor != NULL && this->monitor->stop_requested())) {
+        this->stop();
+        return false;
+    }
+    return true;
+}
+
+// the seconds since the search started
+double SearchController::elapsed() const {
+    std::chrono::duration<double> since_start = std::chrono::steady_clock::now() - this->start_time;
+    return since_start.count();
+}
+
+/*
+ * An upper bound on the rollouts still to come. Exact under a rollout
+ * limit; under a time limit, estimated from the rollout rate so far
+ *
+ * Params: none
+ * Return: a long - the most rollouts the search is expected to do before it ends
+ */
+long SearchController::rollouts_left() const {
+    long started = this->rollouts();
+    long left = LONG_MAX;
+
+    if(this->stopped.load(std::memory_order_relaxed))
+        return 0;
+    if(this->max_rollouts > 0)
+        left = std::max(0L, this->max_rollouts - started);
+
+    double elapsed = this->elapsed();
+    if(this->time_budget > 0 && elapsed > 0 && started > 0) {
+        double rate = started / elapsed;
+        double estimate = rate * std::max(0.0, this->time_budget - elapsed) * ESTIMATE_SLACK;
+        if(estimate < left)
+            left = (long)estimate + 1;
+    }
+    return left;
+}
+
+/*
+ * For MCTS, which reports on a timer: whether the monitor's report
+ * interval has passed since the last report. Only one thread may ask
+ *
+ * Params: none
+ * Return: a bool - true if there is a monitor and a report is due
+ */
+bool SearchController::report_due() {
+    if(this->monitor == NULL)
+        return false;
+    double elapsed = this->elapsed();
+    if(elapsed < this->next_report)
+        return false;
+    this->next_report = elapsed + this->monitor->report_interval;
+    return true;
+}
+
+/*
+ * Passes a report on the search's progress to the monitor, if there is
+ * one. The elapsed time is filled in here
+ *
+ * Params:
+ *     info - the progress to report
+ * Return: none
+ */
+void SearchController::report(search_info_t info) const {
+    if(this->monitor == NULL)
+        return;
+    info.elapsed = this->elapsed();
+    this->monitor->on_report(info);
+}
+
+} // namespace BOARD_NAMESPACE
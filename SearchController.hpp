@@ -0,0 +1,153 @@
+#ifndef SEARCHCONTROLLER_H
+#define SEARCHCONTROLLER_H
+
+// Decides when the AI stops searching for a move: after a wall clock budget,
+// a number of rollouts, or a memory cap, whichever comes first, or when a
+// SearchMonitor asks it to. Shared by every thread searching for the same move
+
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include "amazons.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define ROLLOUTS 10000 // the rollout limit used when neither a time nor a rollout limit is set
+#define MIN_MOVES_TO_GO 4 // the fewest moves the game clock is ever spread over
+#define MAX_CLOCK_FRACTION 0.5 // the most of the game clock a single move may use
+#define ESTIMATE_SLACK 1.25 // how much faster than so far rollouts are assumed to go when estimating
+
+/*
+ * A search's progress, as reported to a SearchMonitor
+ */
+typedef struct search_info {
+    double elapsed; // seconds since the search started
+    long nodes; // rollouts started for MCTS, positions searched for alpha-beta
+    int depth; // the last depth alpha-beta finished, or 0 for MCTS
+    int score; // alpha-beta's score of the best move, for the player to move
+    double win_rate; // the share of the MCTS rollouts through the best move that its player won
+    packed_move_t best_move; // NO_MOVE if there is none yet
+} search_info_t;
+
+/*
+ * Lets whatever drives the AI from outside, such as the headless protocol,
+ * follow a search while it runs and end it early. The searching threads
+ * call back on_report, so it must be safe to call from any thread
+ */
+class SearchMonitor {
+    std::atomic<bool> stop_flag;
+
+    public:
+    double report_interval; // the seconds between reports on an MCTS search
+    void (*on_report)(const search_info_t& info);
+
+    SearchMonitor(void (*on_report)(const search_info_t& info), double report_interval)
+        : stop_flag(false), report_interval(report_interval), on_report(on_report) {}
+
+    // asks the current search to end. It still picks a move from what it has found
+    void request_stop() {this->stop_flag.store(true, std::memory_order_relaxed);}
+
+    // clears a stop request, before the next search starts
+    void reset() {this->stop_flag.store(false, std::memory_order_relaxed);}
+
+    bool stop_requested() const {return this->stop_flag.load(std::memory_order_relaxed);}
+};
+
+class SearchController {
+    std::chrono::steady_clock::time_point start_time;
+    double time_budget; // seconds, or 0 for no time limit
+    long max_rollouts; // 0 for no rollout limit
+    size_t max_memory; // 0 for no memory limit
+    bool early_stop; // whether the search may stop once its result can't change
+
+    std::atomic<long> rollouts_started;
+    std::atomic<bool> stopped;
+
+    SearchMonitor *monitor; // NULL if nothing follows the search
+    double next_report; // the elapsed seconds at which the next report is due
+
+    public:
+    /*
+     * Starts the clock on a search
+     *
+     * Params:
+     *     limits - the limits to search within
+     *     empty_squares - the number of empty squares on the board, used to
+     *                     guess how many moves the game clock has to last
+     *     monitor - what to report the search's progress to and take stop
+     *               requests from, or NULL
+     */
+    SearchController(const search_limits_t& limits, int empty_squares, SearchMonitor *monitor);
+
+    /*
+     * Called by a searching thread before each rollout. Counts the rollout
+     * if it is allowed. The first rollout is always allowed, so that the
+     * search has a move to pick
+     *
+     * Params:
+     *     memory_used - the number of bytes the search tree takes up
+     * Return: a bool - true if the rollout may go ahead, false if the search is over
+     */
+    bool start_rollout(size_t memory_used);
+
+    // ends the search. Threads finish their current rollout and return
+    void stop() {this->stopped.store(true, std::memory_order_relaxed);}
+
+    /*
+     * For searches that don't count rollouts: whether the search has been
+     * stopped or has used up its time budget
+     *
+     * Params: none
+     * Return: a bool - true if the search should end now
+     */
+    bool time_is_up() const {
+        return this->stopped.load(std::memory_order_relaxed)
+               || (this->monitor != NULL && this->monitor->stop_requested())
+               || (this->time_budget > 0 && this->elapsed() >= this->time_budget);
+    }
+
+    // forbids stopping early. For searches whose statistics are split over several trees
+    void disable_early_stop() {this->early_stop = false;}
+    bool early_stop_allowed() const {return this->early_stop;}
+
+    // the seconds since the search started
+    double elapsed() const;
+
+    // the seconds the search may take, or 0 if there is no time limit
+    double get_time_budget() const {return this->time_budget;}
+
+    // the number of rollouts started so far
+    long rollouts() const {return this->rollouts_started.load(std::memory_order_relaxed);}
+
+    /*
+     * An upper bound on the rollouts still to come. Exact under a rollout
+     * limit; under a time limit, estimated from the rollout rate so far
+     *
+     * Params: none
+     * Return: a long - the most rollouts the search is expected to do before it ends
+     */
+    long rollouts_left() const;
+
+    /*
+     * For MCTS, which reports on a timer: whether the monitor's report
+     * interval has passed since the last report. Only one thread may ask
+     *
+     * Params: none
+     * Return: a bool - true if there is a monitor and a report is due
+     */
+    bool report_due();
+
+    /*
+     * Passes a report on the search's progress to the monitor, if there is
+     * one. The elapsed time is filled in here
+     *
+     * Params:
+     *     info - the progress to report
+     * Return: none
+     */
+    void report(search_info_t info) const;
+};
+
+} // namespace BOARD_NAMESPACE
+
+#endif
@@ -0,0 +1,63 @@
+#include <limits.h>
+#include <math.h>
+#include <vector>
+#include "amazons.hpp"
+#include "Selection.hpp"
+
+namespace BOARD_NAMESPACE {
+
+float SelectionPolicy::reciprocals[SELECTION_TABLE_SIZE];
+float SelectionPolicy::inverse_sqrts[SELECTION_TABLE_SIZE];
+float SelectionPolicy::sqrts[SELECTION_TABLE_SIZE];
+float SelectionPolicy::sqrt_logs[SELECTION_TABLE_SIZE];
+
+const bool SelectionPolicy::tables_filled = SelectionPolicy::fill_tables();
+
+// fills the tables. Run once, before main()
+bool SelectionPolicy::fill_tables() {
+    // 0 visits never reach the tables, but the entries are kept finite
+    reciprocals[0] = inverse_sqrts[0] = sqrts[0] = sqrt_logs[0] = 0;
+    for(int n=1; n < SELECTION_TABLE_SIZE; n++) {
+        reciprocals[n] = 1.0f / n;
+        inverse_sqrts[n] = 1.0f / sqrtf(n);
+        sqrts[n] = sqrtf(n);
+        sqrt_logs[n] = sqrtf(logf(n));
+    }
+    return true;
+}
+
+/*
+ * Works out when a node may open each of its children under the passed
+ * widening settings
+ *
+ * Params:
+ *     config - the policy, exploration weight and widening settings
+ */
+SelectionPolicy::SelectionPolicy(const selection_config_t& config) {
+    this->config = config;
+
+    // a node with visits n may have widening_coefficient * n^widening_exponent + 1
+    // children, so it may open child m + 1 once n >= (m / coefficient)^(1 / exponent)
+    if(config.widening_coefficient > 0 && config.widening_exponent > 0) {
+        this->widening_visits.resize(MAX_MOVES + 1);
+        for(int m=0; m <= MAX_MOVES; m++) {
+            double visits = ceil(pow(m / config.widening_coefficient, 1 / config.widening_exponent));
+            this->widening_visits[m] = (visits < INT_MAX) ? (int)visits : INT_MAX;
+        }
+    }
+}
+
+/*
+ * The prior weight of a move, for puct_policy: about 1 on average, and
+ * higher the more the move improves its player's mobility against the
+ * opponent's, up to 2
+ *
+ * Params:
+ *     mobility_gain - the change in the mover's legal moves minus the opponent's
+ * Return: a float - the weight, between 0 and 2
+ */
+float SelectionPolicy::prior_weight(int mobility_gain) {
+    return 2 / (1 + expf(-mobility_gain / PRIOR_MOBILITY_SCALE));
+}
+
+} // namespace BOARD_NAMESPACE
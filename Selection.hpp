@@ -0,0 +1,126 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+// The rule MCTS descends the tree by: which child a rollout continues
+// through, and when a node may open a child for another of its moves.
+// Selection runs at every level of every rollout, so the logarithms,
+// square roots and reciprocals of visit counts it needs are looked up in
+// tables built once, and nothing is allocated
+
+#include <float.h>
+#include <math.h>
+#include <vector>
+#include "amazons.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define SELECTION_TABLE_SIZE (1 << 14) // visit counts below this are looked up rather than computed
+#define SELECTION_UNVISITED FLT_MAX // the score of a child no rollout has been through yet
+#define PRIOR_MOBILITY_SCALE 20.0f // the mobility gain at which a move's prior is about 1.5 times the average
+
+class SelectionPolicy {
+    selection_config_t config;
+
+    // widening_visits[m] is the fewest visits at which a node with m
+    // children may open another, for every m up to MAX_MOVES. Empty
+    // without widening
+    std::vector<int> widening_visits;
+
+    // index n holds the function of n, for 0 < n < SELECTION_TABLE_SIZE
+    static float reciprocals[SELECTION_TABLE_SIZE];
+    static float inverse_sqrts[SELECTION_TABLE_SIZE];
+    static float sqrts[SELECTION_TABLE_SIZE];
+    static float sqrt_logs[SELECTION_TABLE_SIZE];
+
+    // fills the tables. Run once, before main()
+    static bool fill_tables();
+    static const bool tables_filled;
+
+    static float reciprocal(int n) {return (n < SELECTION_TABLE_SIZE) ? reciprocals[n] : 1.0f / n;}
+    static float inverse_sqrt(int n) {return (n < SELECTION_TABLE_SIZE) ? inverse_sqrts[n] : 1.0f / sqrtf(n);}
+
+    public:
+    /*
+     * Works out when a node may open each of its children under the passed
+     * widening settings
+     *
+     * Params:
+     *     config - the policy, exploration weight and widening settings
+     */
+    explicit SelectionPolicy(const selection_config_t& config);
+
+    /*
+     * The part of the exploration term that depends only on the parent, so
+     * that it is worked out once per selection rather than once per child
+     *
+     * Params:
+     *     parent_visits - the rollouts through the parent, at least 1
+     * Return: a float - the term to pass to child_score() for each child
+     */
+    float parent_term(int parent_visits) const {
+        if(this->config.policy == puct_policy) {
+            float root = (parent_visits < SELECTION_TABLE_SIZE) ? sqrts[parent_visits] : sqrtf(parent_visits);
+            return this->config.exploration * root;
+        }
+        float root_log = (parent_visits < SELECTION_TABLE_SIZE) ? sqrt_logs[parent_visits]
+                                                                : sqrtf(logf(parent_visits));
+        return this->config.exploration * root_log;
+    }
+
+    /*
+     * How favorable it is to continue a rollout through a child, for the
+     * player who makes the move to it
+     *
+     * Params:
+     *     wins - the rollouts through the child won by that player
+     *     visits - the rollouts through the child
+     *     prior - the child's prior weight, from prior_weight()
+     *     parent_term - parent_term() of the parent's visits
+     * Return: a float - the higher, the more promising the child
+     */
+    float child_score(int wins, int visits, float prior, float parent_term) const {
+        if(visits == 0)
+            return SELECTION_UNVISITED;
+        float win_rate = wins * reciprocal(visits);
+        if(this->config.policy == puct_policy)
+            return win_rate + parent_term * prior * reciprocal(visits + 1);
+        return win_rate + parent_term * inverse_sqrt(visits);
+    }
+
+    /*
+     * Progressive widening: whether a node has been visited often enough
+     * to open a child for another of its moves. Without widening, every
+     * move gets a child before any child is visited twice
+     *
+     * Params:
+     *     visits - the rollouts through the node
+     *     num_children - the children the node has
+     * Return: a bool - true if the node may open another child
+     */
+    bool may_widen(int visits, int num_children) const {
+        return num_children >= (int)this->widening_visits.size() || visits >= this->widening_visits[num_children];
+    }
+
+    /*
+     * Whether child_score() weighs children by their priors, so that they
+     * are worth working out when a child is opened
+     *
+     * Return: a bool - true under puct_policy
+     */
+    bool uses_priors() const {return this->config.policy == puct_policy;}
+
+    /*
+     * The prior weight of a move, for puct_policy: about 1 on average, and
+     * higher the more the move improves its player's mobility against the
+     * opponent's, up to 2
+     *
+     * Params:
+     *     mobility_gain - the change in the mover's legal moves minus the opponent's
+     * Return: a float - the weight, between 0 and 2
+     */
+    static float prior_weight(int mobility_gain);
+};
+
+} // namespace BOARD_NAMESPACE
+
+#endif
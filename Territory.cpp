@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <algorithm>
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+#include "Territory.hpp"
+
+namespace BOARD_NAMESPACE {
+
+/*
+ * One layer of a breadth first search: the empty squares one move away
+ * from the frontier, by queen moves or by king moves
+ *
+ * Params:
+ *     frontier - the squares reached in the last layer
+ *     empty - the unoccupied squares
+ * Return: the squares one move from the frontier, not yet filtered for ones already reached
+ */
+template<bool QUEEN>
+static inline Bitboard distance_step(const Bitboard& frontier, const Bitboard& empty) {
+    if(QUEEN)
+        return Bitboard::queen_attacks(frontier, empty);
+    return Bitboard::king_dilation(frontier) & empty;
+}
+
+/*
+ * Runs a breadth first search from both players' amazons at once, and
+ * compares their distances. Layer k of a player is the set of squares
+ * they reach in exactly k moves, so all the comparisons are made a layer
+ * at a time with set operations and popcounts
+ *
+ * Params:
+ *     board - the position to search
+ * Return: the comparison of the two players' distances
+ */
+template<bool QUEEN>
+static distance_stats_t relative_distances(const Board& board) {
+    distance_stats_t stats = {0, 0, 0, 0};
+    Bitboard empty = ~board.get_occupied();
+    Bitboard reached[2] = {board.get_amazons(LEFT), board.get_amazons(RIGHT)};
+    Bitboard frontier[2] = {reached[0], reached[1]};
+    Bitboard layers[2][DISTANCE_HISTORY]; // layers[p][k % DISTANCE_HISTORY] is layer k of player p
+
+    for(int k=1; frontier[0].any() || frontier[1].any(); k++) {
+        for(int p=0; p < 2; p++) {
+            frontier[p] = distance_step<QUEEN>(frontier[p], empty) & ~reached[p];
+            layers[p][k % DISTANCE_HISTORY] = frontier[p];
+        }
+        for(int p=0; p < 2; p++) {
+            reached[p] |= frontier[p];
+        }
+
+        int left_new = frontier[0].count();
+        int right_new = frontier[1].count();
+        if(k < CLOSENESS_SHIFT)
+            stats.closeness += (long)(left_new - right_new) << (CLOSENESS_SHIFT - k);
+        stats.territory += (frontier[0] & ~reached[1]).count() - (frontier[1] & ~reached[0]).count();
+        stats.balance += (long)(frontier[0] & frontier[1]).count() << CLOSENESS_SHIFT;
+
+        // the squares reached now which the other player got to d layers ago
+        for(int p=0; p < 2; p++) {
+            Bitboard late = frontier[p] & reached[!p] & ~frontier[!p];
+            int sign = (p == 0) ? -1 : 1; // arriving late is bad for left and good for right
+            int num_late = late.count();
+
+            for(int d=1; d < DISTANCE_HISTORY && d < k && num_late > 0; d++) {
+                int at_d = (late & layers[!p][(k - d) % DISTANCE_HISTORY]).count();
+                stats.balance += (long)at_d << (CLOSENESS_SHIFT - d);
+                stats.advantage += sign * at_d * std::min(d, MAX_ADVANTAGE);
+                num_late -= at_d;
+            }
+            // reached further back than the history goes
+            stats.advantage += sign * num_late * MAX_ADVANTAGE;
+        }
+    }
+
+    // squares only one player can ever reach
+    stats.advantage += MAX_ADVANTAGE * ((reached[0] & empty & ~reached[1]).count()
+                                        - (reached[1] & empty & ~reached[0]).count());
+    return stats;
+}
+
+/*
+ * Runs a breadth first search from both players' amazons at once, with
+ * queen moves (queen = true) or king moves, and compares their distances
+ *
+ * Params:
+ *     board - the position to search
+ *     queen - whether to measure distance in queen moves rather than king moves
+ * Return: the comparison of the two players' distances
+ */
+distance_stats_t relative_distances(const Board& board, bool queen) {
+    return queen ? relative_distances<true>(board) : relative_distances<false>(board);
+}
+
+// the queen moves along direction S from the squares of gen, each weighted
+// by 2^-(k-1) where k is the number of squares it travels
+template<int S>
+static inline int weighted_sliding_moves(Bitboard gen, const Bitboard& empty) {
+    int total = 0;
+
+    for(int k=1; k <= MOBILITY_SHIFT + 1; k++) {
+        gen = gen.template shifted<S>() & empty;
+        int step = gen.count();
+        if(step == 0)
+            break;
+        total += step << (MOBILITY_SHIFT + 1 - k);
+    }
+    return total;
+}
+
+/*
+ * Sums the queen moves of a player's amazons, each weighted by 2^-(k-1)
+ * where k is how many squares away it ends, so that the squares next to
+ * an amazon count the most and a boxed in amazon counts for little
+ *
+ * Params:
+ *     board - the position
+ *     player - the player whose amazons to count
+ * Return: an int - the weighted sum, in units of 2^-MOBILITY_SHIFT
+ */
+int weighted_mobility(const Board& board, player_t player) {
+    const Bitboard& gen = board.get_amazons(player);
+    Bitboard empty = ~board.get_occupied();
+
+    return weighted_sliding_moves<-BBWIDTH - 1>(gen, empty)
+         + weighted_sliding_moves<-BBWIDTH>(gen, empty)
+         + weighted_sliding_moves<-BBWIDTH + 1>(gen, empty)
+         + weighted_sliding_moves<-1>(gen, empty)
+         + weighted_sliding_moves<1>(gen, empty)
+         + weighted_sliding_moves<BBWIDTH - 1>(gen, empty)
+         + weighted_sliding_moves<BBWIDTH>(gen, empty)
+         + weighted_sliding_moves<BBWIDTH + 1>(gen, empty);
+}
+
+/*
+ * Works out every term of the territory evaluation of a position
+ *
+ * Params:
+ *     board - the position
+ * Return: the terms, from left's point of view
+ */
+territory_terms_t territory_terms(const Board& board) {
+    territory_terms_t terms;
+    distance_stats_t queen = relative_distances<true>(board);
+    distance_stats_t king = relative_distances<false>(board);
+    int empty_squares = board.num_empty_squares();
+
+    terms.queen_territory = queen.territory;
+    terms.king_territory = king.territory;
+    terms.queen_closeness = 2.0 * queen.closeness / (1L << CLOSENESS_SHIFT);
+    terms.king_closeness = (double)king.advantage / MAX_ADVANTAGE;
+    terms.mobility = (double)(weighted_mobility(board, LEFT) - weighted_mobility(board, RIGHT))
+                     / (1 << MOBILITY_SHIFT);
+    terms.phase = 0;
+    if(empty_squares > 0)
+        terms.phase = (double)queen.balance / ((long)empty_squares << CLOSENESS_SHIFT);
+    return terms;
+}
+
+// the weight of a term at the passed phase of the game
+static inline double weight_at(const term_weight_t& weight, double phase) {
+    return weight.endgame + (weight.opening - weight.endgame) * phase;
+}
+
+/*
+ * A territory based heuristic which estimates which player the position is
+ * more favorable for. Positive values are better for left; negative are
+ * better for right
+ *
+ * Params:
+ *     board - the position
+ *     weights - how much each term counts
+ * Return:
+ *     an int - the more positive, the better for left
+ *              the more negative, the better for right
+ */
+int evaluate_territory(const Board& board, const territory_weights_t& weights) {
+    territory_terms_t terms = territory_terms(board);
+
+    return (int)(weight_at(weights.queen_territory, terms.phase) * terms.queen_territory
+               + weight_at(weights.king_territory, terms.phase) * terms.king_territory
+               + weight_at(weights.queen_closeness, terms.phase) * terms.queen_closeness
+               + weight_at(weights.king_closeness, terms.phase) * terms.king_closeness
+               + weight_at(weights.mobility, terms.phase) * terms.mobility);
+}
+
+// same as evaluate_territory(), but prints the terms to stdout
+int evaluate_territory_verbose(const Board& board, const territory_weights_t& weights) {
+    territory_terms_t terms = territory_terms(board);
+    int eval = evaluate_territory(board, weights);
+
+    printf("queen territory: %i\n", terms.queen_territory);
+    printf("king territory: %i\n", terms.king_territory);
+    printf("queen closeness: %.2f\n", terms.queen_closeness);
+    printf("king closeness: %.2f\n", terms.king_closeness);
+    printf("mobility: %.2f\n", terms.mobility);
+    printf("phase: %.2f\n", terms.phase);
+    printf("Final eval: %i\n", eval);
+    return eval;
+}
+
+} // namespace BOARD_NAMESPACE
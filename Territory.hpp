@@ -0,0 +1,95 @@
+#ifndef TERRITORY_H
+#define TERRITORY_H
+
+// A territory based evaluation: who reaches each empty square first, by
+// queen moves and by king moves, found with a breadth first search run on
+// whole bitboards at once for both players side by side. The terms are
+// weighted differently in the opening, when most squares are contested,
+// and the endgame, when the board has split into separate regions
+
+#include "amazons.hpp"
+#include "Bitboard.hpp"
+#include "Board.hpp"
+
+namespace BOARD_NAMESPACE {
+
+#define DISTANCE_HISTORY 8 // BFS layers kept to compare when each player reached a square
+#define CLOSENESS_SHIFT 16 // fixed point precision of the closeness and balance sums
+#define MAX_ADVANTAGE 6 // king distance lead at which a square counts as fully owned
+#define MOBILITY_SHIFT 8 // fixed point precision of the mobility sums
+
+/*
+ * What the search of one distance metric found. Each compares the left
+ * player's distance DL to a square with the right player's DR
+ */
+typedef struct distance_stats {
+    int territory; // squares left reaches first minus squares right reaches first
+    long closeness; // sum of 2^-DL - 2^-DR, in units of 2^-CLOSENESS_SHIFT
+    long balance; // sum of 2^-|DL - DR| over squares both reach, same units
+    int advantage; // sum of DR - DL clamped to +-MAX_ADVANTAGE, counting unreachable as far
+} distance_stats_t;
+
+/*
+ * The terms of the evaluation of a position, all from left's point of view
+ */
+typedef struct territory_terms {
+    int queen_territory; // squares left reaches first with queen moves, minus right's
+    int king_territory; // squares left reaches first with king moves, minus right's
+    double queen_closeness; // 2 * sum of 2^-DL - 2^-DR, with queen move distances
+    double king_closeness; // sum of (DR - DL) / MAX_ADVANTAGE clamped to +-1, king distances
+    double mobility; // left's distance weighted amazon mobility minus right's
+    double phase; // 1 when every square is contested, falling to 0 as the regions separate
+} territory_terms_t;
+
+/*
+ * Runs a breadth first search from both players' amazons at once, with
+ * queen moves (queen = true) or king moves, and compares their distances
+ *
+ * Params:
+ *     board - the position to search
+ *     queen - whether to measure distance in queen moves rather than king moves
+ * Return: the comparison of the two players' distances
+ */
+distance_stats_t relative_distances(const Board& board, bool queen);
+
+/*
+ * Sums the queen moves of a player's amazons, each weighted by 2^-(k-1)
+ * where k is how many squares away it ends, so that the squares next to
+ * an amazon count the most and a boxed in amazon counts for little
+ *
+ * Params:
+ *     board - the position
+ *     player - the player whose amazons to count
+ * Return: an int - the weighted sum, in units of 2^-MOBILITY_SHIFT
+ */
+int weighted_mobility(const Board& board, player_t player);
+
+/*
+ * Works out every term of the territory evaluation of a position
+ *
+ * Params:
+ *     board - the position
+ * Return: the terms, from left's point of view
+ */
+territory_terms_t territory_terms(const Board& board);
+
+/*
+ * A territory based heuristic which estimates which player the position is
+ * more favorable for. Positive values are better for left; negative are
+ * better for right
+ *
+ * Params:
+ *     board - the position
+ *     weights - how much each term counts
+ * Return:
+ *     an int - the more positive, the better for left
+ *              the more negative, the better for right
+ */
+int evaluate_territory(const Board& board, const territory_weights_t& weights);
+
+// same as evaluate_territory(), but prints the terms to stdout
+int evaluate_territory_verbose(const Board& board, const territory_weights_t& weights);
+
+} // namespace BOARD_NAMESPACE
+
+#endif
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include "TranspositionTable.hpp"
+
+#define CACHE_LINE 64
+
+// clamps a count into the range an entry can hold
+static inline uint64_t clamp_count(int count) {
+    return count < 0 ? 0 : (count > TT_MAX_COUNT ? TT_MAX_COUNT : count);
+}
+
+/*
+ * Allocates an empty table
+ *
+ * Params:
+ *     bytes - the most memory the table may take. Rounded down to a
+ *             power of two number of buckets
+ */
+TranspositionTable::TranspositionTable(size_t bytes) {
+    size_t bucket_bytes = TT_BUCKET_SIZE * sizeof(uint64_t);
+    void *memory = NULL;
+
+    this->num_buckets = 1;
+    while(this->num_buckets * 2 * bucket_bytes <= bytes)
+        this->num_buckets *= 2;
+
+    if(posix_memalign(&memory, CACHE_LINE, this->num_buckets * bucket_bytes) != 0)
+        throw std::bad_alloc();
+    this->entries = static_cast<std::atomic<uint64_t> *>(memory);
+    for(size_t i=0; i < this->num_buckets * TT_BUCKET_SIZE; i++)
+        new(&this->entries[i]) std::atomic<uint64_t>(0);
+
+    this->probes = 0;
+    this->hits = 0;
+    this->stores = 0;
+    this->replacements = 0;
+}
+
+TranspositionTable::~TranspositionTable() {
+    free(this->entries); // std::atomic<uint64_t> has a trivial destructor
+}
+
+/*
+ * Finds the entry of a position, giving it an empty one if it has none.
+ * A full bucket gives up the entry with the fewest rollouts, which is
+ * the cheapest to lose. Nodes keep the entry, so that reading and
+ * updating it later doesn't search the bucket again
+ *
+ * Params:
+ *     key - the position, from Board::position_key()
+ * Return: the position's entry, or NULL if another thread took the
+ *         chosen entry first
+ */
+std::atomic<uint64_t> *TranspositionTable::entry(uint64_t key) {
+    std::atomic<uint64_t> *entries = this->bucket(key);
+    uint64_t tag = tagged(key);
+    int victim = 0;
+    uint64_t victim_value = 0;
+    int fewest_rollouts = TT_MAX_COUNT + 1;
+
+    this->probes.fetch_add(1, std::memory_order_relaxed);
+    for(int i=0; i < TT_BUCKET_SIZE; i++) {
+        uint64_t value = entries[i].load(std::memory_order_relaxed);
+
+        if(entry_tag(value) == tag) {
+            this->hits.fetch_add(1, std::memory_order_relaxed);
+            return &entries[i];
+        }
+
+        int rollouts = (value == 0) ? -1 : entry_rollouts(value); // unused entries go first
+        if(rollouts < fewest_rollouts) {
+            fewest_rollouts = rollouts;
+            victim = i;
+            victim_value = value;
+        }
+    }
+
+    if(!entries[victim].compare_exchange_strong(victim_value, tag, std::memory_order_relaxed))
+        return NULL;
+    this->stores.fetch_add(1, std::memory_order_relaxed);
+    if(victim_value != 0)
+        this->replacements.fetch_add(1, std::memory_order_relaxed);
+    return &entries[victim];
+}
+
+/*
+ * Adds to the statistics of a position, unless its entry has been given
+ * to another position. Counts are kept between 0 and TT_MAX_COUNT
+ *
+ * Params:
+ *     entry - the entry entry() gave for key
+ *     key - the position
+ *     wins - the number to add to the position's wins
+ *     rollouts - the number to add to its rollouts. May be negative, to
+ *                take back a virtual loss
+ * Return: none
+ */
+void TranspositionTable::add(std::atomic<uint64_t> *entry, uint64_t key, int wins, int rollouts) {
+    uint64_t tag = tagged(key);
+    uint64_t value = entry->load(std::memory_order_relaxed);
+    uint64_t updated;
+
+    do {
+        if(entry_tag(value) != tag)
+            return;
+        updated = tag | (clamp_count(entry_rollouts(value) + rollouts) << TT_COUNT_BITS)
+                  | clamp_count(entry_wins(value) + wins);
+    } while(!entry->compare_exchange_weak(value, updated, std::memory_order_relaxed));
+}
+
+// empties the table and zeroes the counters
+void TranspositionTable::clear() {
+    for(size_t i=0; i < this->num_buckets * TT_BUCKET_SIZE; i++)
+        this->entries[i].store(0, std::memory_order_relaxed);
+    this->probes = 0;
+    this->hits = 0;
+    this->stores = 0;
+    this->replacements = 0;
+}
+
+// a snapshot of the counters
+transposition_stats_t TranspositionTable::get_stats() const {
+    return {this->probes.load(), this->hits.load(), this->stores.load(), this->replacements.load()};
+}
+
+// prints the counters to stdout
+void TranspositionTable::print_stats() const {
+    transposition_stats_t stats = this->get_stats();
+    double hit_rate = (stats.probes > 0) ? 100.0 * stats.hits / stats.probes : 0;
+
+    printf("transposition table: %ld probes, %.1f%% hits, %ld stores, %ld replacements\n",
+           stats.probes, hit_rate, stats.stores, stats.replacements);
+}
@@ -0,0 +1,125 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+// A fixed size table of rollout statistics keyed by position, shared by
+// every node of the search tree that reaches the same position by a
+// different order of moves. This turns the tree into a graph as far as
+// node selection is concerned. Each entry is a single 64 bit word updated
+// with compare and swap, so the table needs no locks and a reader can
+// never see half of an update
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+
+#define TT_BUCKET_SIZE 8 // entries per bucket, which fill one 64 byte cache line
+#define TT_TAG_BITS 19 // bits of the key stored in an entry to tell positions sharing a bucket apart
+#define TT_COUNT_BITS 22 // bits of each of the two counts in an entry
+#define TT_MAX_COUNT ((1 << TT_COUNT_BITS) - 1) // counts stop growing here
+
+// how well the table is serving the search
+typedef struct transposition_stats {
+    long probes; // positions looked up, one per node created
+    long hits; // positions found already in the table: transpositions
+    long stores; // positions given an entry
+    long replacements; // stores that threw out another position's entry
+} transposition_stats_t;
+
+class TranspositionTable {
+    std::atomic<uint64_t> *entries; // num_buckets buckets of TT_BUCKET_SIZE entries, cache line aligned
+    size_t num_buckets; // a power of two
+
+    std::atomic<long> probes;
+    std::atomic<long> hits;
+    std::atomic<long> stores;
+    std::atomic<long> replacements;
+
+    // the bucket a position's entry can be in
+    std::atomic<uint64_t> *bucket(uint64_t key) const {
+        return this->entries + (key & (this->num_buckets - 1)) * TT_BUCKET_SIZE;
+    }
+
+    // an entry is an in use bit, a tag from the top bits of the key, the
+    // rollouts and the wins. An unused entry is 0
+    static uint64_t tagged(uint64_t key) {
+        return (2 * (key >> (64 - TT_TAG_BITS)) + 1) << (2 * TT_COUNT_BITS);
+    }
+    static uint64_t entry_tag(uint64_t entry) {return entry & ~((1ULL << (2 * TT_COUNT_BITS)) - 1);}
+    static int entry_rollouts(uint64_t entry) {return (entry >> TT_COUNT_BITS) & TT_MAX_COUNT;}
+    static int entry_wins(uint64_t entry) {return entry & TT_MAX_COUNT;}
+
+    public:
+    /*
+     * Allocates an empty table
+     *
+     * Params:
+     *     bytes - the most memory the table may take. Rounded down to a
+     *             power of two number of buckets
+     */
+    explicit TranspositionTable(size_t bytes);
+
+    ~TranspositionTable();
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // the memory the table takes, in bytes
+    size_t bytes() const {return this->num_buckets * TT_BUCKET_SIZE * sizeof(uint64_t);}
+
+    /*
+     * Finds the entry of a position, giving it an empty one if it has none.
+     * A full bucket gives up the entry with the fewest rollouts, which is
+     * the cheapest to lose. Nodes keep the entry, so that reading and
+     * updating it later doesn't search the bucket again
+     *
+     * Params:
+     *     key - the position, from Board::position_key()
+     * Return: the position's entry, or NULL if another thread took the
+     *         chosen entry first
+     */
+    std::atomic<uint64_t> *entry(uint64_t key);
+
+    /*
+     * Reads the statistics of a position from its entry
+     *
+     * Params:
+     *     entry - the entry entry() gave for key
+     *     key - the position
+     *     wins - set to the position's wins
+     *     rollouts - set to the position's rollouts
+     * Return: a bool - false if the entry has been given to another position since
+     */
+    static bool read(const std::atomic<uint64_t> *entry, uint64_t key, int *wins, int *rollouts) {
+        uint64_t value = entry->load(std::memory_order_relaxed);
+        if(entry_tag(value) != tagged(key))
+            return false;
+        *wins = entry_wins(value);
+        *rollouts = entry_rollouts(value);
+        return true;
+    }
+
+    /*
+     * Adds to the statistics of a position, unless its entry has been given
+     * to another position. Counts are kept between 0 and TT_MAX_COUNT
+     *
+     * Params:
+     *     entry - the entry entry() gave for key
+     *     key - the position
+     *     wins - the number to add to the position's wins
+     *     rollouts - the number to add to its rollouts. May be negative, to
+     *                take back a virtual loss
+     * Return: none
+     */
+    static void add(std::atomic<uint64_t> *entry, uint64_t key, int wins, int rollouts);
+
+    // empties the table and zeroes the counters
+    void clear();
+
+    // a snapshot of the counters
+    transposition_stats_t get_stats() const;
+
+    // prints the counters to stdout
+    void print_stats() const;
+};
+
+#endif
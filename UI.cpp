@@ -9,6 +9,8 @@
 #include "Board.hpp"
 #include "UI.hpp"
 
+namespace BOARD_NAMESPACE {
+
 #define BUFLEN 32
 
 /*
@@ -324,4 +326,6 @@ void print_rules() {
         perror("read");
         exit(1);
     }
-}
\ No newline at end of file
+}
+
+} // namespace BOARD_NAMESPACE
@@ -6,6 +6,8 @@
 #include "Board.hpp"
 #include "amazons.hpp"
 
+namespace BOARD_NAMESPACE {
+
 // converts from the enum representing a square's state to the icon printed to 
 // indicate that state
 #define tile_icon(t) (t == open) ? ' ' : \
@@ -83,4 +85,6 @@ void bot_move_recognition(Board board, move_t move);
 // prints the rules of the game
 void print_rules();
 
+} // namespace BOARD_NAMESPACE
+
 #endif
\ No newline at end of file
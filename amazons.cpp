@@ -2,23 +2,131 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <algorithm>
+#include <chrono>
 #include "amazons.hpp"
 #include "Board.hpp"
+#include "Evaluator.hpp"
 #include "UI.hpp"
 #include "MoveTree.hpp"
+#include "AlphaBeta.hpp"
+#include "Protocol.hpp"
 
-// This file containts the main function for the program
+// This file contains the program for one board width; main.cpp picks which width runs
 
-#ifndef TESTS
+namespace BOARD_NAMESPACE {
 
-int main(int argc, char *argv[]) {
+thread_local uint64_t rng_state = 1;
+
+// prints the command line options and exits
+void usage(const char *program) {
+    fprintf(stderr, "usage: %s [--size 6|8|10] [--headless] [--verbose] [--threads n]\n"
+                    "       [--parallel tree|root|leaf]\n"
+                    "       [--movetime seconds] [--clock seconds] [--inc seconds]\n"
+                    "       [--rollouts n] [--memory megabytes] [--eval classic|territory]\n"
+                    "       [--weights file] [--tt megabytes] [--evalcache megabytes]\n"
+                    "       [--engine mcts|alphabeta] [--left-engine mcts|alphabeta]\n"
+                    "       [--right-engine mcts|alphabeta] [--depth plies] [--split]\n"
+                    "       [--select uct|puct] [--explore c] [--widen coefficient exponent]\n", program);
+    exit(1);
+}
+
+// runs the program on this width's board, see amazons.hpp
+int run(int argc, char *argv[]) {
     srand(time(NULL));
+    seed_fast_rand(time(NULL));
 
     char action;
     bool print_eval = false;
+    bool headless = false;
+    ai_config_t config = DEFAULT_AI_CONFIG;
+
+    for(int i=1; i < argc; i++) {
+        if(strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            // main() has already picked the width; any other is not one there is an engine for
+            if(atoi(argv[++i]) != BOARDWIDTH)
+                usage(argv[0]);
+        } else if(strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if(strcmp(argv[i], "--verbose") == 0) {
+            print_eval = true;
+        } else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            config.num_threads = atoi(argv[++i]);
+            if(config.num_threads < 1)
+                usage(argv[0]);
+        } else if(strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+            i++;
+            if(strcmp(argv[i], "tree") == 0)
+                config.parallel_mode = tree_parallel;
+            else if(strcmp(argv[i], "root") == 0)
+                config.parallel_mode = root_parallel;
+            else if(strcmp(argv[i], "leaf") == 0)
+                config.parallel_mode = leaf_parallel;
+            else
+                usage(argv[0]);
+        } else if(strcmp(argv[i], "--movetime") == 0 && i + 1 < argc) {
+            config.limits.move_time = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            config.limits.clock = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--inc") == 0 && i + 1 < argc) {
+            config.limits.increment = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--rollouts") == 0 && i + 1 < argc) {
+            config.limits.max_rollouts = atol(argv[++i]);
+        } else if(strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            config.limits.max_memory = (size_t)atol(argv[++i]) << 20;
+        } else if(strcmp(argv[i], "--eval") == 0 && i + 1 < argc) {
+            i++;
+            if(strcmp(argv[i], "classic") == 0)
+                config.evaluator.type = classic_evaluator;
+            else if(strcmp(argv[i], "territory") == 0)
+                config.evaluator.type = territory_evaluator;
+            else
+                usage(argv[0]);
+        } else if(strcmp(argv[i], "--tt") == 0 && i + 1 < argc) {
+            config.transposition_bytes = (size_t)atol(argv[++i]) << 20;
+        } else if(strcmp(argv[i], "--evalcache") == 0 && i + 1 < argc) {
+            config.eval_cache_bytes = (size_t)atol(argv[++i]) << 20;
+        } else if((strcmp(argv[i], "--engine") == 0 || strcmp(argv[i], "--left-engine") == 0
+                   || strcmp(argv[i], "--right-engine") == 0) && i + 1 < argc) {
+            engine_t engine;
+            if(strcmp(argv[i + 1], "mcts") == 0)
+                engine = mcts_engine;
+            else if(strcmp(argv[i + 1], "alphabeta") == 0)
+                engine = alphabeta_engine;
+            else
+                usage(argv[0]);
+            if(strcmp(argv[i], "--right-engine") != 0)
+                config.engine[LEFT] = engine;
+            if(strcmp(argv[i], "--left-engine") != 0)
+                config.engine[RIGHT] = engine;
+            i++;
+        } else if(strcmp(argv[i], "--split") == 0) {
+            config.split_moves = true;
+        } else if(strcmp(argv[i], "--select") == 0 && i + 1 < argc) {
+            i++;
+            if(strcmp(argv[i], "uct") == 0)
+                config.selection.policy = uct_policy;
+            else if(strcmp(argv[i], "puct") == 0)
+                config.selection.policy = puct_policy;
+            else
+                usage(argv[0]);
+        } else if(strcmp(argv[i], "--explore") == 0 && i + 1 < argc) {
+            config.selection.exploration = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--widen") == 0 && i + 2 < argc) {
+            config.selection.widening_coefficient = atof(argv[++i]);
+            config.selection.widening_exponent = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            config.limits.max_depth = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+            if(!load_evaluator_config(argv[++i], config.evaluator))
+                usage(argv[0]);
+        } else {
+            usage(argv[0]);
+        }
+    }
 
-    if(argc > 1 && strcmp(argv[1], "--verbose") == 0)
-        print_eval = true;
+    if(headless)
+        return run_protocol(config);
 
     while(true) {
         action = start_screen();
@@ -28,16 +136,16 @@ int main(int argc, char *argv[]) {
                 print_rules();
                 break;
             case 't':
-                play_game(false, false, print_eval);
+                play_game(false, false, print_eval, config);
                 break;
             case 'f':
-                play_game(false, true, print_eval);
+                play_game(false, true, print_eval, config);
                 break;
             case 's':
-                play_game(true, false, print_eval);
+                play_game(true, false, print_eval, config);
                 break;
             case 'w':
-                play_game(true, true, print_eval);
+                play_game(true, true, print_eval, config);
                 break;
             default:
                 exit_app();
@@ -47,20 +155,21 @@ int main(int argc, char *argv[]) {
     return 0;
 }
 
-#endif
-
 /*
- * The ai makes a move
+ * The ai makes a move, with the engine config picks for the player
  *
  * Params:
- *     player - which player the ai is moving for
  *     board - the board on which to make a move
- * Return: none
+ *     player - the player to move
+ *     config - the settings to search with
+ *     tree - the MCTS search tree, rooted at the current position
+ *     searcher - the alpha-beta searcher
+ * Return: the move the ai made
  */
-move_t ai_move(Board& board, player_t player) {
-    MoveTree tree(board, player);
-
-    return tree.make_move(board);
+move_t ai_move(Board& board, player_t player, ai_config_t config, MoveTree *tree, AlphaBeta *searcher) {
+    if(config.engine[player] == alphabeta_engine)
+        return searcher->make_move(board, player, config);
+    return tree->make_move(board, config);
 }
 
 /*
@@ -70,27 +179,67 @@ move_t ai_move(Board& board, player_t player) {
  *     left_ai - whether the left player is an AI
  *     right_ai - whether the right player is an AI
  *     print_eval - whether to print an AI evaluation of the position
+ *     config - the settings the AI players search with
  * Return: none
  */
-void play_game(bool left_ai, bool right_ai, bool print_eval) {
+void play_game(bool left_ai, bool right_ai, bool print_eval, ai_config_t config) {
     Board board;
     player_t current_player = LEFT; //left goes first
+    move_t move;
+
+    // the ai keeps its search tree between turns. The tree follows every move
+    // made, so the part of the search below the position that actually arises
+    // is kept. When the ai plays both sides, they share the tree, so each
+    // search starts from what the other side's search found about the reply
+    bool uses_mcts = (left_ai && config.engine[LEFT] == mcts_engine)
+                     || (right_ai && config.engine[RIGHT] == mcts_engine);
+    bool uses_alphabeta = (left_ai && config.engine[LEFT] == alphabeta_engine)
+                          || (right_ai && config.engine[RIGHT] == alphabeta_engine);
+    MoveTree *tree = uses_mcts ? new MoveTree(board, current_player) : NULL;
+    // the alpha-beta searcher keeps its move ordering statistics between turns
+    AlphaBeta *searcher = uses_alphabeta ? new AlphaBeta() : NULL;
+
+    // the time left on each ai's game clock, if the game is played with one
+    double clock_left[2] = {config.limits.clock, config.limits.clock};
 
     while(!board.no_moves(current_player)) {
         if(print_eval)
-            board.evaluate_verbose();
+            evaluate_verbose(config.evaluator, board);
 
         if((current_player == LEFT) ? left_ai : right_ai) { // if it's an ai's turn
-            // bot_move = ai_move(board, current_player);
             board.print();
-            bot_move_recognition(board, ai_move(board, current_player));
+            config.limits.clock = clock_left[current_player];
+            printf("The computer is thinking...\n");
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            move = ai_move(board, current_player, config, tree, searcher);
+            if(clock_left[current_player] > 0) {
+                std::chrono::duration<double> taken = std::chrono::steady_clock::now() - start;
+                // a clock that runs out is left at a sliver, so the ai keeps moving quickly
+                clock_left[current_player] = std::max(clock_left[current_player] - taken.count(), 0.01)
+                                             + config.limits.increment;
+            }
+            bot_move_recognition(board, move);
+            if(print_eval && config.engine[current_player] == alphabeta_engine)
+                searcher->print_stats();
+            if(print_eval && config.engine[current_player] == mcts_engine && tree->get_transpositions() != NULL)
+                tree->get_transpositions()->print_stats();
+            if(print_eval && config.engine[current_player] == mcts_engine && tree->get_eval_cache() != NULL)
+                tree->get_eval_cache()->print_stats();
         } else { // it's a human's turn
             board.print();
-            human_move(board, current_player);
+            move = human_move(board, current_player);
         }
+
+        if(tree != NULL)
+            tree->advance(pack_move(move));
+
         // swap current player
         current_player = !current_player;
     }
 
+    delete tree;
+    delete searcher;
     game_over(current_player);
-}
\ No newline at end of file
+}
+
+} // namespace BOARD_NAMESPACE
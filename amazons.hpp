@@ -4,18 +4,38 @@
 // This is a header file with some micscellaneous types
 // that are used throughout the project
 
+#include <stdint.h>
 #include <stdlib.h>
 
-#ifdef TINY
-  #define BOARDWIDTH 6
+// The board is BOARDWIDTH squares a side: 6, 8 or 10, with -DBOARDWIDTH=n.
+// The Makefile compiles the engine once for each width, so that the
+// geometry below is a compile time constant in every loop, and main.cpp
+// picks which one to run. LEFT_START_SQUARES are left's amazons, as
+// {row, column} with row 1 at the top; right's mirror them through the centre
+#ifndef BOARDWIDTH
+  #define BOARDWIDTH 10
+#endif
+
+#if BOARDWIDTH == 6
+  #define AMAZONS_PER_PLAYER 2
+  #define LEFT_START_SQUARES {{1, 2}, {2, 6}}
+#elif BOARDWIDTH == 8
+  #define AMAZONS_PER_PLAYER 3
+  #define LEFT_START_SQUARES {{1, 5}, {2, 1}, {3, 8}}
+#elif BOARDWIDTH == 10
+  #define AMAZONS_PER_PLAYER 4
+  #define LEFT_START_SQUARES {{1, 4}, {1, 7}, {4, 1}, {4, 10}}
 #else
-  #ifdef SMALL
-    #define BOARDWIDTH 8
-  #else
-    #define BOARDWIDTH 10
-  #endif
+  #error "BOARDWIDTH must be 6, 8 or 10"
 #endif
 
+// everything that depends on the width lives in a namespace of its own
+// (board6, board8 or board10), so that the engines for every width can be
+// linked into one program
+#define BOARD_NAMESPACE_OF(width) board##width
+#define BOARD_NAMESPACE_EXPAND(width) BOARD_NAMESPACE_OF(width)
+#define BOARD_NAMESPACE BOARD_NAMESPACE_EXPAND(BOARDWIDTH)
+
 #define BBWIDTH (BOARDWIDTH + 2)
 #define SETSIZE (BBWIDTH * BBWIDTH)
 #define INCRS_INIT {-BBWIDTH - 1, -BBWIDTH, -BBWIDTH + 1, \
@@ -24,6 +44,13 @@
 #define TOP_LEFT (BBWIDTH + 1)
 #define BOTTOM_RIGHT (BBWIDTH * (BBWIDTH - 1) - 2)
 
+// an upper bound on the number of squares a queen can move to in one move,
+// and so on the branching factor of the game
+#define MAX_QUEEN_MOVES (4 * (BOARDWIDTH - 1))
+#define MAX_MOVES (AMAZONS_PER_PLAYER * MAX_QUEEN_MOVES * MAX_QUEEN_MOVES)
+
+namespace BOARD_NAMESPACE {
+
 typedef bool player_t;
 
 #define LEFT true
@@ -77,6 +104,213 @@ typedef struct move {
     Point arrow;
 } move_t;
 
+/*
+ * A move packed into 32 bits: the bitboard indices of the amazon's old square,
+ * its new square and the arrow, 8 bits each (SETSIZE is at most 144).
+ * This is what the AI stores and copies around; move_t is only used by the UI
+ */
+typedef uint32_t packed_move_t;
+
+#define NO_MOVE ((packed_move_t)0) // index 0 is a border square, so this is never a real move
+
+static inline packed_move_t pack_move(int old_loc, int new_loc, int arrow) {
+    return (packed_move_t)old_loc | ((packed_move_t)new_loc << 8) | ((packed_move_t)arrow << 16);
+}
+
+static inline int move_old_loc(packed_move_t move) {return move & 0xff;}
+static inline int move_new_loc(packed_move_t move) {return (move >> 8) & 0xff;}
+static inline int move_arrow(packed_move_t move) {return (move >> 16) & 0xff;}
+
+// converts a move from the UI's representation to the packed one
+static inline packed_move_t pack_move(move_t move) {
+    return pack_move(move.old_loc.to_bbval(), move.new_loc.to_bbval(), move.arrow.to_bbval());
+}
+
+// converts a packed move to the UI's representation
+static inline move_t unpack_move(packed_move_t move) {
+    return {Point(move_old_loc(move)), Point(move_new_loc(move)), Point(move_arrow(move))};
+}
+
+/*
+ * A fixed capacity list of moves, big enough for every move in any position.
+ * Lives on the stack (or inside another object), so filling it never touches
+ * the heap
+ */
+class MoveList {
+    packed_move_t moves[MAX_MOVES];
+    int length;
+
+    public:
+    MoveList() {length = 0;}
+
+    int size() const {return length;}
+    bool empty() const {return length == 0;}
+    void clear() {length = 0;}
+    void push(packed_move_t move) {moves[length++] = move;}
+    void swap(int a, int b) {packed_move_t move = moves[a]; moves[a] = moves[b]; moves[b] = move;}
+
+    packed_move_t operator[](int index) const {return moves[index];}
+
+    const packed_move_t *begin() const {return moves;}
+    const packed_move_t *end() const {return moves + length;}
+};
+
+/*
+ * A small xorshift random number generator with one state per thread, so that
+ * search threads don't contend on the lock inside rand()
+ */
+extern thread_local uint64_t rng_state;
+
+static inline void seed_fast_rand(uint64_t seed) {
+    rng_state = (seed + 1) * 0x9E3779B97F4A7C15ULL; // never zero for small seeds
+}
+
+// returns a random int in [0, 2^31)
+static inline int fast_rand() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (int)((rng_state * 0x2545F4914F6CDD1DULL) >> 33);
+}
+
+/*
+ * How the AI spreads its search over several threads:
+ *     tree_parallel - every thread searches one shared tree
+ *     root_parallel - every thread searches its own tree, and the trees' root
+ *                     statistics are merged at the end
+ *     leaf_parallel - one thread searches the tree, and the other threads help
+ *                     play out each new leaf several times at once
+ */
+typedef enum {tree_parallel, root_parallel, leaf_parallel} parallel_mode_t;
+
+/*
+ * The heuristic the AI scores the positions at the end of its rollouts with:
+ *     classic_evaluator - ClassicEvaluator: the difference in legal moves plus
+ *                         a multiple of the difference in accessible squares
+ *     territory_evaluator - TerritoryEvaluator: who reaches each empty square
+ *                           first by queen and by king moves, and mobility
+ */
+typedef enum {classic_evaluator, territory_evaluator} evaluator_t;
+
+// the weights of the classic heuristic's two terms
+typedef struct classic_weights {
+    int moves; // per legal move
+    int access; // per accessible square
+} classic_weights_t;
+
+#define DEFAULT_CLASSIC_WEIGHTS {1, 100}
+
+// how much one term of the territory heuristic counts at each end of the
+// game. In between, the weight slides from one to the other with the phase
+typedef struct term_weight {
+    double opening;
+    double endgame;
+} term_weight_t;
+
+typedef struct territory_weights {
+    term_weight_t queen_territory;
+    term_weight_t king_territory;
+    term_weight_t queen_closeness;
+    term_weight_t king_closeness;
+    term_weight_t mobility;
+} territory_weights_t;
+
+// in eval points, where a square of territory late in the game is worth 100
+// like an accessible square is in the classic heuristic
+#define DEFAULT_TERRITORY_WEIGHTS { \
+    {40, 100}, /* queen_territory */ \
+    {30, 20},  /* king_territory */ \
+    {40, 0},   /* queen_closeness */ \
+    {30, 0},   /* king_closeness */ \
+    {10, 0}    /* mobility */ \
+}
+
+// which heuristic to use, and the weights for each
+typedef struct evaluator_config {
+    evaluator_t type;
+    classic_weights_t classic;
+    territory_weights_t territory;
+} evaluator_config_t;
+
+#define DEFAULT_EVALUATOR_CONFIG {classic_evaluator, DEFAULT_CLASSIC_WEIGHTS, DEFAULT_TERRITORY_WEIGHTS}
+
+/*
+ * The rule MCTS picks the child to continue a rollout through by:
+ *     uct_policy - UCT: the child's win rate plus
+ *                  exploration * sqrt(ln(parent visits) / child visits)
+ *     puct_policy - PUCT: the child's win rate plus
+ *                   exploration * prior * sqrt(parent visits) / (1 + child visits),
+ *                   where a move's prior grows with the mobility it gains
+ */
+typedef enum {uct_policy, puct_policy} selection_policy_t;
+
+/*
+ * How MCTS descends its tree. With progressive widening, a node visited n
+ * times may have children for widening_coefficient * n^widening_exponent + 1
+ * of its moves, so that moves are only opened as fast as the visits can
+ * tell them apart. A coefficient of 0 turns widening off
+ */
+typedef struct selection_config {
+    selection_policy_t policy;
+    float exploration; // the weight of the exploration term
+    float widening_coefficient;
+    float widening_exponent;
+} selection_config_t;
+
+#define DEFAULT_SELECTION_CONFIG {uct_policy, 0.4, 0.5, 0.5}
+
+/*
+ * How long the AI may search for a move. Every limit set is respected, and
+ * the search stops at whichever runs out first. A limit of 0 is unset
+ */
+typedef struct search_limits {
+    double move_time; // seconds to spend on each move
+    double clock; // seconds left on the AI's game clock, spread over the rest of the game
+    double increment; // seconds added to the game clock after each move
+    long max_rollouts; // rollouts to do for each move
+    size_t max_memory; // bytes the search tree may take up
+    int max_depth; // plies the alpha-beta engine searches to
+} search_limits_t;
+
+#define DEFAULT_MOVE_TIME 2.0
+#define DEFAULT_MAX_MEMORY ((size_t)512 << 20)
+#define DEFAULT_SEARCH_LIMITS {DEFAULT_MOVE_TIME, 0, 0, 0, DEFAULT_MAX_MEMORY, 0}
+
+/*
+ * The search an AI player picks its moves with:
+ *     mcts_engine - MoveTree: Monte Carlo tree search
+ *     alphabeta_engine - AlphaBeta: principal variation search with
+ *                        iterative deepening
+ */
+typedef enum {mcts_engine, alphabeta_engine} engine_t;
+
+class SearchMonitor; // see SearchController.hpp
+
+/*
+ * Settings for the AI, parsed from the command line
+ */
+typedef struct ai_config {
+    int num_threads; // the number of threads that search for a move together
+    parallel_mode_t parallel_mode;
+    search_limits_t limits;
+    evaluator_config_t evaluator;
+    selection_config_t selection;
+    // 0 to search a plain tree. Otherwise the bytes of a transposition table
+    // through which nodes reached by different move orders share statistics
+    size_t transposition_bytes;
+    size_t eval_cache_bytes; // the bytes of the cache of leaf scores, or 0 for none
+    engine_t engine[2]; // the search each player uses, indexed by player_t
+    // whether MCTS opens the amazon move and the arrow of each move as
+    // separate levels of its tree, each with its own statistics
+    bool split_moves;
+    // follows each search and can stop it, for the headless protocol. NULL for none
+    SearchMonitor *monitor;
+} ai_config_t;
+
+#define DEFAULT_AI_CONFIG {1, tree_parallel, DEFAULT_SEARCH_LIMITS, DEFAULT_EVALUATOR_CONFIG, \
+                           DEFAULT_SELECTION_CONFIG, 0, 0, \
+                           {mcts_engine, mcts_engine}, false, NULL}
+
 /*
  * Gets and makes moves from each player until someone can't go
  *
@@ -84,8 +318,21 @@ typedef struct move {
  *     left_ai - whether the left player is an AI
  *     right_ai - whether the right player is an AI
  *     print_eval - whether to print an AI evaluation of the position
+ *     config - the settings the AI players search with
  * Return: none
  */
-void play_game(bool left_ai, bool right_ai, bool print_eval);
+void play_game(bool left_ai, bool right_ai, bool print_eval, ai_config_t config);
+
+/*
+ * Parses the command line options and runs the program on this width's board
+ *
+ * Params:
+ *     argc - the number of command line arguments
+ *     argv - the command line arguments, as main() gets them
+ * Return: the exit status
+ */
+int run(int argc, char *argv[]);
+
+} // namespace BOARD_NAMESPACE
 
 #endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include <stdlib.h>
+#include <string.h>
+
+// This file contains the main function for the program. The engine is
+// compiled once for each board width, into the namespaces board6, board8
+// and board10 (see amazons.hpp), and main() runs the one --size asks for
+
+namespace board6 {int run(int argc, char *argv[]);}
+namespace board8 {int run(int argc, char *argv[]);}
+namespace board10 {int run(int argc, char *argv[]);}
+
+int main(int argc, char *argv[]) {
+    int width = 10;
+    for(int i=1; i + 1 < argc; i++) {
+        if(strcmp(argv[i], "--size") == 0)
+            width = atoi(argv[i + 1]);
+    }
+
+    // any other width is left to board10, which rejects it with the usage message
+    if(width == 6)
+        return board6::run(argc, argv);
+    if(width == 8)
+        return board8::run(argc, argv);
+    return board10::run(argc, argv);
+}
@@ -8,6 +8,7 @@
 #include "MoveTree.hpp"
 
 using namespace std;
+using namespace BOARD_NAMESPACE;
 
 int main() {
     printf("%i", sizeof(MoveTree));